@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <ts/ts.hpp>
+
+
+using namespace std;
+using namespace ts;
+
+
+typedef Series<int64_t, double, ChunkedStorage<> > Chunked;
+
+
+// Times a way of filling a series with n observations
+template<class S=Series<int64_t, double>, class Fill>
+void bench(const char* name, size_t n, Fill fill)
+{
+  S s;
+  auto start = std::chrono::steady_clock::now();
+  fill(s);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  cout << name << ": " << n / elapsed.count() / 1e6 << " M rows/s"
+       << " (" << s.size() << " rows)" << endl;
+}
+
+
+// The slowest single append while appending n observations one by one
+template<class S>
+void worst_append(const char* name, const std::vector<int64_t>& ix,
+                  const std::vector<double>& vals)
+{
+  S s;
+  std::chrono::duration<double> worst(0);
+  for (size_t i=0; i < ix.size(); ++i) {
+    auto start = std::chrono::steady_clock::now();
+    s.append(ix[i], vals[i]);
+    worst = std::max<std::chrono::duration<double> >(
+        worst, std::chrono::steady_clock::now() - start);
+  }
+  cout << name << ": the slowest append took " << worst.count() * 1e3
+       << " ms" << endl;
+}
+
+
+int main()
+{
+  const size_t n = 20000000;
+  const size_t block = 4096;
+  std::vector<int64_t> ix(n);
+  std::vector<double> vals(n);
+  for (size_t i=0; i < n; ++i) {
+    ix[i] = 1000 + 3 * i;
+    vals[i] = i * 0.5;
+  }
+
+  bench("append", n, [&](Series<int64_t, double>& s) {
+    for (size_t i=0; i < n; ++i) s.append(ix[i], vals[i]);
+  });
+  bench("reserve + append", n, [&](Series<int64_t, double>& s) {
+    s.reserve(n);
+    for (size_t i=0; i < n; ++i) s.append(ix[i], vals[i]);
+  });
+  bench("reserve + append_unchecked", n, [&](Series<int64_t, double>& s) {
+    s.reserve(n);
+    for (size_t i=0; i < n; ++i) s.append_unchecked(ix[i], vals[i]);
+  });
+  bench("reserve + append_bulk", n, [&](Series<int64_t, double>& s) {
+    s.reserve(n);
+    for (size_t i=0; i < n; i += block) {
+      s.append_bulk(&ix[i], &vals[i], std::min(block, n - i));
+    }
+  });
+  bench<Chunked>("chunked append", n, [&](Chunked& s) {
+    for (size_t i=0; i < n; ++i) s.append(ix[i], vals[i]);
+  });
+  bench<Chunked>("chunked append_bulk", n, [&](Chunked& s) {
+    for (size_t i=0; i < n; i += block) {
+      s.append_bulk(&ix[i], &vals[i], std::min(block, n - i));
+    }
+  });
+
+  worst_append<Series<int64_t, double> >("vector", ix, vals);
+  worst_append<Chunked>("chunked", ix, vals);
+  return 0;
+}
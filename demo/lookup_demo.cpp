@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ts/ts.hpp>
+
+
+using namespace std;
+using namespace ts;
+
+
+// Times n lookups and prints the rate and a checksum of the values found
+template<class Lookup>
+void bench(const char* name, size_t n, Lookup lookup)
+{
+  auto start = std::chrono::steady_clock::now();
+  double check = lookup();
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  cout << name << ": " << n / elapsed.count() / 1e6 << " M lookups/s"
+       << " (checksum " << check << ")" << endl;
+}
+
+
+int main()
+{
+  const size_t n = 50000000;
+  const size_t n_queries = 2000000;
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> jitter(0, 999);
+
+  // near-uniformly spaced timestamps (1 ms apart with jitter) in us
+  std::vector<int64_t> ix(n);
+  std::vector<double> vals(n);
+  for (size_t i=0; i < n; ++i) {
+    ix[i] = 1000 * int64_t(i) + jitter(rng);
+    vals[i] = i * 0.5;
+  }
+  Series<int64_t, double> s(std::move(ix), std::move(vals));
+
+  std::uniform_int_distribution<int64_t> pick(0, s.indexView().back());
+  std::vector<int64_t> queries(n_queries);
+  for (auto& q: queries) q = pick(rng);
+
+  bench("std::lower_bound", n_queries, [&]() {
+    double sum = 0;
+    auto& index = s.indexView();
+    for (auto q: queries) {
+      auto loc = std::lower_bound(index.begin(), index.end(), q);
+      sum += s.valuesView()[loc - index.begin()];
+    }
+    return sum;
+  });
+  bench("at (interpolation search)", n_queries, [&]() {
+    double sum = 0;
+    for (auto q: queries) sum += s.at(q);
+    return sum;
+  });
+
+  std::sort(queries.begin(), queries.end());
+  bench("sorted, std::lower_bound", n_queries, [&]() {
+    double sum = 0;
+    auto& index = s.indexView();
+    for (auto q: queries) {
+      auto loc = std::lower_bound(index.begin(), index.end(), q);
+      sum += s.valuesView()[loc - index.begin()];
+    }
+    return sum;
+  });
+  bench("sorted, at_many", n_queries, [&]() {
+    double sum = 0;
+    for (auto v: s.at_many(queries)) sum += v;
+    return sum;
+  });
+  return 0;
+}
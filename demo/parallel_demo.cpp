@@ -0,0 +1,48 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <ts/ts.hpp>
+#include <ts/merge.hpp>
+#include <ts/parallel.hpp>
+
+
+using namespace std;
+using namespace ts;
+using namespace ts::filters;
+
+
+int main()
+{
+  // many symbols, each run through the same rolling mean pipeline
+  const int n_series = 2000;
+  const int n_obs = 5000;
+  std::vector<Series<int64_t, double> > series(n_series);
+  std::srand(1);
+  for (auto& s: series) {
+    for (int64_t t=0; t < n_obs; ++t) s.append(t, std::rand() % 1000);
+  }
+  SeriesCollection<Series<int64_t, double> > coll;
+  for (auto& s: series) coll.push_back(&s);
+
+  auto factory = []() {
+    return Accumulator<RollingMean, int64_t>(RollingMean(20));
+  };
+
+  size_t max_threads = std::thread::hardware_concurrency();
+  if (max_threads == 0) max_threads = 1;
+  double serial = 0;
+  for (size_t n_threads=1; n_threads <= max_threads; n_threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    auto res = apply_each_parallel(coll, factory, n_threads);
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    if (n_threads == 1) serial = elapsed.count();
+    cout << n_threads << " threads: " << elapsed.count() << " s"
+         << " (speedup " << serial / elapsed.count() << ", "
+         << res.size() << " series)" << endl;
+  }
+  return 0;
+}
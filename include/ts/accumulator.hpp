@@ -10,7 +10,30 @@
 
 namespace ts {
 
+namespace impl {
+
+/// Pushes (timestamp, value) to the filters accepting timestamps.
+template<class Filter, class Timestamp, class Value>
+auto push(Filter& filter, Timestamp t, const Value& v, int)
+  -> decltype(filter(t, v), void())
+{
+  filter(t, v);
+}
+
+/// Pushes the value only to the other filters.
+template<class Filter, class Timestamp, class Value>
+void push(Filter& filter, Timestamp, const Value& v, long)
+{
+  filter(v);
+}
+
+} // namespace impl
+
+
 /// Pushes value to the filter and stores its output in the time series.
+///
+/// The filters which can be called with (timestamp, value), such as the
+/// time-windowed ones, are passed the timestamps as well.
 template<class Filter, class Timestamp>
 class Accumulator
 {
@@ -27,20 +50,21 @@ class Accumulator
   void operator() (Timestamp t, input_type v)
   {
     // update the filter if the input is not NA
-    if (na::can_na<input_type>) {
+    if (na::can_na<input_type>()) {
       if (!na::is_na<input_type>(v)) {
-        filter(v);
+        impl::push(filter, t, v, 0);
       }
     } else {
-      filter(v);
+      impl::push(filter, t, v, 0);
     }
-    // write to output if the current output is not NA
-    if (na::can_na<output_type>) {
+    // write to output if the current output is not NA (or, for the output
+    // types without NA, if the filter is ready)
+    if (na::can_na<output_type>()) {
       auto cur_output = filter.value();
       if (!na::is_na<output_type>(cur_output)) {
-        output.append(t, filter.value());
+        output.append(t, cur_output);
       }
-    } else {
+    } else if (filter.ready()) {
       output.append(t, filter.value());
     }
   }
@@ -1,50 +1,268 @@
-// aggregators.hpp - aggregation functors (sum, first, last).
+// aggregators.hpp - aggregation functors (sum, first, last, ohlc, ...).
 
 #ifndef AGGREGATORS_HPP
 #define AGGREGATORS_HPP 
 
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <ts/exceptions.hpp>
 #include <ts/na.hpp>
 
 
 namespace ts {
 
-// Functor computing the sum of the values; initially nan.
+namespace impl {
+
+// Should the aggregators skip x? Only the NA values are skipped; the check
+// disappears at compile time for the types without NA.
+template<typename T>
+bool skip(const T& x) { return na::can_na<T>() && na::is_na<T>(x); }
+
+// The type of the sums of T values: 64-bit integers for the integral types
+// so that the small types do not overflow, T otherwise.
+template<typename T, bool = std::is_integral<T>::value>
+struct sum_type { using type = T; };
+
+template<typename T>
+struct sum_type<T, true>
+{
+  using type = typename std::conditional<
+    std::is_signed<T>::value, int64_t, uint64_t>::type;
+};
+
+// sum += x; throws instead of wrapping around for the integral types.
+template<typename S, typename T>
+typename std::enable_if<!std::is_integral<S>::value>::type
+add_to(S& sum, T x) { sum += x; }
+
+template<typename S, typename T>
+typename std::enable_if<std::is_integral<S>::value>::type
+add_to(S& sum, T x)
+{
+  if (__builtin_add_overflow(sum, x, &sum))
+    throw TsException("Aggregator: integer overflow");
+}
+
+} // namespace impl
+
+
+// Functor computing the sum of the values; initially NA (0 for the types
+// without NA). Integers are summed exactly in 64 bits.
+template<typename T=double>
 struct Sum
 {
-  Sum(): val(na::na<double>()) {}
-  void operator() (double x){
-    if (na::is_na<double>(x)) return;
-    val = na::is_na<double>(val) ? x : val + x;
+  using sum_type = typename impl::sum_type<T>::type;
+  Sum(): val(), seen(false) {}
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    impl::add_to(val, x);
+    seen = true;
   }
-  double value() const { return val; }
+  sum_type value() const { return seen ? val : na::na_or_default<sum_type>(); }
  private:
-  double val;
+  sum_type val;
+  bool seen;
 };
 
-// Functor memorizing the first value; initially nan.
+// Functor memorizing the last value; initially NA (T() for the types
+// without NA).
+template<typename T=double>
 struct Last
 {
-  Last(): val(na::na<double>()) {}
-  void operator() (double x){
-    if (na::is_na<double>(x)) return;
+  Last(): val(na::na_or_default<T>()) {}
+  void operator() (T x){
+    if (impl::skip(x)) return;
     val = x;
   }
-  double value() const { return val; }
+  T value() const { return val; }
  private:
-  double val;
+  T val;
 };
 
-// Functor memorizing the last value; initially nan.
+// Functor memorizing the first value; initially NA (T() for the types
+// without NA).
+template<typename T=double>
 struct First
 {
-  First(): val(na::na<double>()) {}
-  void operator() (double x) {
-    if (na::is_na<double>(x)) return;
-    val = na::is_na<double>(val) ? x : val;
+  First(): val(na::na_or_default<T>()), seen(false) {}
+  void operator() (T x) {
+    if (impl::skip(x) || seen) return;
+    val = x;
+    seen = true;
+  }
+  T value() const { return val; }
+ private:
+  T val;
+  bool seen;
+};
+
+// Functor counting the values which are not NA.
+template<typename T=double>
+struct Count
+{
+  Count(): n(0) {}
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    ++n;
+  }
+  size_t value() const { return n; }
+ private:
+  size_t n;
+};
+
+// Functor computing the mean of the values; initially NA.
+template<typename T=double>
+struct Mean
+{
+  using sum_type = typename impl::sum_type<T>::type;
+  Mean(): sum(), n(0) {}
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    impl::add_to(sum, x);
+    ++n;
   }
-  double value() const { return val; }
+  double value() const { return n > 0 ? double(sum) / n : na::na<double>(); }
  private:
-  double val;
+  sum_type sum;
+  size_t n;
+};
+
+// Functor computing the minimum of the values; initially NA (T() for the
+// types without NA).
+template<typename T=double>
+struct Min
+{
+  Min(): val(na::na_or_default<T>()), seen(false) {}
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    if (!seen || x < val) val = x;
+    seen = true;
+  }
+  T value() const { return val; }
+ private:
+  T val;
+  bool seen;
+};
+
+// Functor computing the maximum of the values; initially NA (T() for the
+// types without NA).
+template<typename T=double>
+struct Max
+{
+  Max(): val(na::na_or_default<T>()), seen(false) {}
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    if (!seen || val < x) val = x;
+    seen = true;
+  }
+  T value() const { return val; }
+ private:
+  T val;
+  bool seen;
+};
+
+// The open, high, low and close values of a bar.
+template<typename T=double>
+struct OhlcBar
+{
+  T open;
+  T high;
+  T low;
+  T close;
+};
+
+// Functor computing the first, maximum, minimum and last values at once;
+// initially all NA (T() for the types without NA).
+template<typename T=double>
+struct Ohlc
+{
+  Ohlc(): seen(false) {
+    bar.open = bar.high = bar.low = bar.close = na::na_or_default<T>();
+  }
+  void operator() (T x) {
+    if (impl::skip(x)) return;
+    if (!seen) {
+      bar.open = bar.high = bar.low = x;
+      seen = true;
+    } else {
+      if (bar.high < x) bar.high = x;
+      if (x < bar.low) bar.low = x;
+    }
+    bar.close = x;
+  }
+  OhlcBar<T> value() const { return bar; }
+ private:
+  OhlcBar<T> bar;
+  bool seen;
+};
+
+// Functor computing the volume weighted average price of (price, volume)
+// pairs; initially NA. The pairs with a NA price or volume are skipped.
+template<typename T=double>
+struct Vwap
+{
+  Vwap(): pv(0), volume(0) {}
+  void operator() (T price, T vol) {
+    if (impl::skip(price) || impl::skip(vol)) return;
+    pv += double(price) * double(vol);
+    volume += double(vol);
+  }
+  void operator() (const std::pair<T, T>& x) {
+    operator()(x.first, x.second);
+  }
+  double value() const { return volume != 0 ? pv / volume : na::na<double>(); }
+ private:
+  double pv;
+  double volume;
+};
+
+// Functor passing the I-th element of tuple-like values (e.g. the volume of
+// (price, volume) pairs) to the aggregator.
+template<size_t I, class Aggregator>
+struct Field
+{
+  template<class T>
+  void operator() (const T& x) { agg(std::get<I>(x)); }
+  auto value() const -> decltype(std::declval<const Aggregator&>().value()) {
+    return agg.value();
+  }
+ private:
+  Aggregator agg;
+};
+
+// Functor passing each value to several aggregators at once; its value is
+// the tuple of their values.
+template<class... Aggregators>
+struct Fused
+{
+  using aggregators_type = std::tuple<Aggregators...>;
+  template<class T>
+  void operator() (const T& x) {
+    update(x, std::index_sequence_for<Aggregators...>());
+  }
+  auto value() const -> decltype(auto) {
+    return value(std::index_sequence_for<Aggregators...>());
+  }
+  // The I-th aggregator
+  template<size_t I>
+  const typename std::tuple_element<I, aggregators_type>::type& get() const {
+    return std::get<I>(aggs);
+  }
+ private:
+  template<class T, size_t... I>
+  void update(const T& x, std::index_sequence<I...>) {
+    int dummy[] = {0, (std::get<I>(aggs)(x), 0)...};
+    (void)dummy;
+  }
+  template<size_t... I>
+  auto value(std::index_sequence<I...>) const -> decltype(auto) {
+    return std::make_tuple(std::get<I>(aggs).value()...);
+  }
+  aggregators_type aggs;
 };
 
 }
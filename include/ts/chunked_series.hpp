@@ -0,0 +1,368 @@
+// chunked_series.hpp - series stored in fixed-size chunks
+
+#ifndef CHUNKED_SERIES_HPP
+#define CHUNKED_SERIES_HPP
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+/// The storage policy keeping the observations in chunks of ChunkSize
+/// timestamps and values.
+template<size_t ChunkSize=4096>
+struct ChunkedStorage
+{
+  static_assert(ChunkSize > 0, "ChunkedStorage: ChunkSize must be positive");
+};
+
+namespace impl {
+
+/// A block of ChunkSize observations stored column by column.
+template<typename Timestamp, typename Value, size_t ChunkSize>
+struct Chunk
+{
+  Timestamp index[ChunkSize];
+  Value values[ChunkSize];
+};
+
+
+/// Paired (index, value) iterator over a chunked series. Walks the chunks
+/// in order, i.e. sequentially within each chunk.
+template<typename Timestamp, typename Value, size_t ChunkSize>
+class ChunkedIter
+{
+  typedef Chunk<Timestamp, Value, ChunkSize> chunk_type;
+
+ public:
+  typedef ChunkedIter<Timestamp, Value, ChunkSize> this_type;
+
+  ChunkedIter(): chunk_(nullptr), pos_(0) {}
+
+  /// Points to the observation pos in the chunk *chunk
+  ChunkedIter(const std::unique_ptr<chunk_type>* chunk, size_t pos)
+    : chunk_(chunk),
+      pos_(pos)
+  {}
+
+  /// Prefix increment
+  this_type& operator++()
+  {
+    if (++pos_ == ChunkSize) {
+      ++chunk_;
+      pos_ = 0;
+    }
+    return *this;
+  }
+
+  /// Postfix increment
+  this_type operator++(int)
+  {
+    auto old = *this;
+    operator++();
+    return old;
+  }
+
+  bool operator==(const this_type& other) const
+  {
+    return chunk_ == other.chunk_ && pos_ == other.pos_;
+  }
+
+  bool operator!=(const this_type& other) const { return !(*this == other); }
+
+  /// Index at the current position
+  const Timestamp& index() const { return (*chunk_)->index[pos_]; }
+
+  /// Value at the current position
+  const Value& value() const { return (*chunk_)->values[pos_]; }
+
+ private:
+  const std::unique_ptr<chunk_type>* chunk_; ///< The current chunk
+  size_t pos_;                               ///< Position in the chunk
+};
+
+} // namespace impl
+
+
+/// A time series stored in fixed-size chunks of ChunkSize observations
+/// with a directory of pointers to them.
+///
+/// Appending never moves the observations already stored: when the last
+/// chunk is full a new one is allocated and only its pointer is added to
+/// the directory, so there are no copies of the whole history like when a
+/// vector reallocates. The directory still grows geometrically unless it
+/// is reserved but it is ChunkSize times smaller than the data. Within a
+/// chunk the index and the values are contiguous so the paired iteration
+/// and the application of functors stay sequential.
+///
+/// The chunks are the segments of impl::SegmentedBase which provides the
+/// application of functors, parallel_apply(), the moments and at_many()
+/// shared with the contiguous Series. The index and the values are not
+/// contiguous as a whole so, unlike the contiguous Series, there are no
+/// slice(), view(), indexView() and valuesView(); the views of the
+/// contiguous ranges are available chunk by chunk by chunk().
+template<typename Timestamp, typename Value, size_t ChunkSize>
+class Series<Timestamp, Value, ChunkedStorage<ChunkSize> >
+  : public impl::SegmentedBase<
+        Series<Timestamp, Value, ChunkedStorage<ChunkSize> >,
+        Timestamp, Value>
+{
+  typedef impl::Chunk<Timestamp, Value, ChunkSize> chunk_type;
+
+ public: // declarations and consts
+
+  typedef Series<Timestamp, Value, ChunkedStorage<ChunkSize> > this_type;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef impl::ChunkedIter<Timestamp, Value, ChunkSize> paired_iterator_type;
+
+  static constexpr size_t chunk_size = ChunkSize;
+
+ private: // variables
+
+  std::vector<std::unique_ptr<chunk_type> > chunks_; ///< The directory
+  size_t size_;                                      ///< Number of points
+
+ public: // methods
+
+  /// Creates an empty Series
+  Series(): size_(0) {}
+
+  /// Creates a Series from index and value vectors
+  Series(const std::vector<Timestamp>& index,
+         const std::vector<Value>& values)
+    : size_(0)
+  {
+    if (index.size() != values.size()) {
+      throw SizeError("The index and the values must be of the same size.");
+    }
+    if (!std::is_sorted(index.begin(), index.end())) {
+      throw IndexNotSorted("Provided a non-sorted index in a constructor.");
+    }
+    reserve(index.size());
+    for (size_t i=0; i < index.size(); ++i) {
+      append_unchecked(index[i], values[i]);
+    }
+  }
+
+  Series(const this_type& other): size_(0) { *this = other; }
+
+  /// Takes the chunks of other leaving it empty
+  Series(this_type&& other)
+    : chunks_(std::move(other.chunks_)),
+      size_(other.size_)
+  {
+    other.chunks_.clear();
+    other.size_ = 0;
+  }
+
+  this_type& operator=(const this_type& other)
+  {
+    if (this == &other) return *this;
+    std::vector<std::unique_ptr<chunk_type> > chunks;
+    chunks.reserve(other.chunks_.size());
+    for (auto& c: other.chunks_) {
+      chunks.emplace_back(new chunk_type(*c));
+    }
+    chunks_ = std::move(chunks);
+    size_ = other.size_;
+    return *this;
+  }
+
+  /// Takes the chunks of other leaving it empty
+  this_type& operator=(this_type&& other)
+  {
+    if (this == &other) return *this;
+    chunks_ = std::move(other.chunks_);
+    size_ = other.size_;
+    other.chunks_.clear();
+    other.size_ = 0;
+    return *this;
+  }
+
+  /// Returns the length of the time series
+  size_t size() const { return size_; }
+
+  /// Number of allocated chunks
+  size_t n_chunks() const { return chunks_.size(); }
+
+  /// The non-owning view of the observations of the chunk i
+  SeriesView<Timestamp, Value> chunk(size_t i) const
+  {
+    return SeriesView<Timestamp, Value>(chunks_[i]->index,
+                                        chunks_[i]->values, chunk_length(i));
+  }
+
+  /// Number of segments (see impl::SegmentedBase), i.e. the chunks
+  size_t n_segments() const { return chunks_.size(); }
+
+  /// The observations of the chunk i
+  impl::Segment<Timestamp, Value> segment(size_t i) const
+  {
+    return {chunks_[i]->index, chunks_[i]->values, chunk_length(i)};
+  }
+
+  /// Adds a new observation at the end. Throws a TsException
+  /// if the new observation's index precedes the last value of
+  /// the current index
+  void append(Timestamp ix, Value val)
+  {
+    if (size_ > 0 && ix <= last_index()) {
+      throw IndexNotSorted(
+        "Appending with a timestamp not greater than the last index element."
+      );
+    }
+    append_unchecked(ix, val);
+  }
+
+  /// Adds n observations at the end. Throws an IndexNotSorted exception
+  /// (and adds nothing) unless the timestamps of the block are strictly
+  /// increasing and follow the last timestamp of the series.
+  void append_bulk(const Timestamp* ix, const Value* vals, size_t n)
+  {
+    if (n == 0) return;
+    bool increasing = size_ == 0 || last_index() < ix[0];
+    for (size_t i=1; i < n; ++i) increasing &= ix[i - 1] < ix[i];
+    if (!increasing) {
+      throw IndexNotSorted(
+        "Appending a block of timestamps which are not increasing."
+      );
+    }
+    while (n > 0) {
+      size_t pos = size_ % ChunkSize;
+      if (pos == 0) chunks_.emplace_back(new chunk_type);
+      size_t m = std::min(n, ChunkSize - pos);
+      std::copy(ix, ix + m, chunks_.back()->index + pos);
+      std::copy(vals, vals + m, chunks_.back()->values + pos);
+      ix += m;
+      vals += m;
+      n -= m;
+      size_ += m;
+    }
+  }
+
+  /// Adds a new observation at the end without checking the timestamp.
+  /// For the trusted sources which guarantee the order.
+  void append_unchecked(Timestamp ix, Value val)
+  {
+    size_t pos = size_ % ChunkSize;
+    if (pos == 0) chunks_.emplace_back(new chunk_type);
+    chunks_.back()->index[pos] = ix;
+    chunks_.back()->values[pos] = val;
+    ++size_;
+  }
+
+  /// Reserves the directory for n observations so that appending up to n
+  /// observations only allocates the new chunks
+  void reserve(size_t n)
+  {
+    chunks_.reserve((n + ChunkSize - 1) / ChunkSize);
+  }
+
+  /// Number of observations which fit in the allocated chunks
+  size_t capacity() const { return chunks_.size() * ChunkSize; }
+
+  /// Finds the value corresponding to a given index value
+  Value& at(Timestamp x)
+  {
+    // the first chunk whose last timestamp is not less than x
+    size_t lo = 0, hi = chunks_.size();
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (chunk_back(mid) < x) lo = mid + 1; else hi = mid;
+    }
+    if (lo == chunks_.size()) {
+      throw IndexError<Timestamp>(x);
+    }
+    auto& c = *chunks_[lo];
+    auto loc = impl::timestamp_lower_bound(c.index, c.index + chunk_length(lo),
+                                           x);
+    return c.values[loc - c.index];
+  }
+
+  /// Finds the value corresponding to a given index value
+  Value& operator[](Timestamp x){ return at(x); }
+
+  /// Paired (index, value) iterators to the beginning
+  paired_iterator_type begin_paired() const
+  {
+    return paired_iterator_type(chunks_.data(), 0);
+  }
+
+  /// Paired (index, value) iterators to the end
+  paired_iterator_type end_paired() const
+  {
+    return paired_iterator_type(chunks_.data() + size_ / ChunkSize,
+                                size_ % ChunkSize);
+  }
+
+  /// Compares first the index and then the values
+  bool operator==(const this_type& other) const
+  {
+    if (size_ != other.size_) return false;
+    for (size_t i=0; i < n_chunks(); ++i) {
+      auto n = chunk_length(i);
+      auto& a = *chunks_[i];
+      auto& b = *other.chunks_[i];
+      if (!std::equal(a.index, a.index + n, b.index)) return false;
+      if (!std::equal(a.values, a.values + n, b.values)) return false;
+    }
+    return true;
+  }
+
+  /// Copies the observations to a contiguous series
+  Series<Timestamp, Value> to_series() const
+  {
+    std::vector<Timestamp> index;
+    std::vector<Value> values;
+    index.reserve(size_);
+    values.reserve(size_);
+    for (size_t i=0; i < n_chunks(); ++i) {
+      auto c = chunk(i);
+      index.insert(index.end(), c.index_data(), c.index_data() + c.size());
+      values.insert(values.end(), c.values_data(),
+                    c.values_data() + c.size());
+    }
+    return Series<Timestamp, Value>::from_sorted(std::move(index),
+                                                 std::move(values));
+  }
+
+  /// Convert to a human-readable string
+  std::string to_string(std::string sep=std::string(", ")) const
+  {
+    std::ostringstream out;
+    for (auto c = begin_paired(); c != end_paired(); ++c) {
+      out << c.index() << ":" << c.value() << sep;
+    }
+    return out.str();
+  }
+
+ private: // methods
+
+  /// Number of observations in the chunk i
+  size_t chunk_length(size_t i) const
+  {
+    return i + 1 < chunks_.size() ? ChunkSize : size_ - i * ChunkSize;
+  }
+
+  /// The last timestamp of the chunk i
+  const Timestamp& chunk_back(size_t i) const
+  {
+    return chunks_[i]->index[chunk_length(i) - 1];
+  }
+
+  /// The last timestamp of the series
+  const Timestamp& last_index() const { return chunk_back(n_chunks() - 1); }
+};
+
+} // namespace ts
+
+#endif /* CHUNKED_SERIES_HPP */
@@ -3,12 +3,16 @@
 #ifndef COVARIANCE_HPP
 #define COVARIANCE_HPP
 
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 #include <vector>
 
 #include <ts/exceptions.hpp>
 #include <ts/aggregators.hpp>
+#include <ts/merge.hpp>
 #include <ts/na_guard.hpp>
+#include <ts/parallel.hpp>
 #include <ts/filters/online_moments.hpp>
 
 
@@ -22,12 +26,11 @@ namespace impl {
 /// this point it calls the functor on aggregated values and continues
 /// to iterate the series.
 //
-template<typename Aggregator, typename Functor,
-         typename Timestamp, typename Value>
+template<typename Aggregator, typename Functor, typename Series>
 Functor& aggregate_and_apply(
     Functor& f,
-    const Series<Timestamp, Value>& x,
-    const Series<Timestamp, Value>& y
+    const Series& x,
+    const Series& y
 ){
   auto cx = x.begin_paired(), xend = x.end_paired();
   auto cy = y.begin_paired(), yend = y.end_paired();
@@ -72,36 +75,43 @@ Functor& aggregate_and_apply(
 //
 // Public API for computing moments of Series/vectors
 //
+// The Aggregator is a template of aggregators (e.g. Sum, Last, First)
+// instantiated with the value type of the series.
+//
 /*! \file */ 
 
 // Apply a covariance filter to the series (unknown means).
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 auto apply_cov(const Series& x, const Series& y) -> decltype(auto)
 {
   auto est = filters::OnlineCovUnknownMeans();
-  impl::aggregate_and_apply<Aggregator>( est, x, y );
+  impl::aggregate_and_apply<Aggregator<typename Series::value_type> >(
+      est, x, y
+  );
   return est;
 }
 
 // Apply a covariance filter to the series (known means).
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 auto apply_cov(const Series& x, const Series& y,
                double x_mean, double y_mean) -> decltype(auto)
 {
   auto est = filters::OnlineCovKnownMeans(x_mean, y_mean);
-  impl::aggregate_and_apply<Aggregator>( est, x, y );
+  impl::aggregate_and_apply<Aggregator<typename Series::value_type> >(
+      est, x, y
+  );
   return est;
 }
 
 // Covariance of two series with unknown means.
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 double cov(const Series& x, const Series& y)
 {
   return apply_cov<Aggregator>(x, y).cov();
 }
 
 // Covariance of two series with known means.
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 double cov(const Series& x, const Series& y,
            double x_mean, double y_mean)
 {
@@ -109,19 +119,160 @@ double cov(const Series& x, const Series& y,
 }
 
 // Correlation of two series with unknown means.
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 double corr(const Series& x, const Series& y)
 {
   return apply_cov<Aggregator>(x, y).corr();
 }
 
 // Correlation of two series with known means.
-template<typename Aggregator=Sum, typename Series>
+template<template<typename> class Aggregator=Sum, typename Series>
 double corr(const Series& x, const Series& y, double x_mean, double y_mean)
 {
   return apply_cov<Aggregator>(x, y, x_mean, y_mean).corr();
 }
 
+/// Covariance matrix of several series.
+///
+/// The co-moments (n times the covariances) are kept in a packed upper
+/// triangular matrix whose row i holds the entries (i, i), ..., (i, N-1).
+/// The observations are added in blocks of rows: the co-moments of a block
+/// are computed from the deviations from the block means (two passes over
+/// the block) and merged with the previous ones by the update of
+///
+/// Chan, T. F., Golub, G. H., LeVeque, R. J. (1979). "Updating Formulae and
+/// a Pairwise Algorithm for Computing Sample Variances". Stanford.
+///
+/// The rows of the triangle are independent so they are updated in
+/// parallel, each by a loop over contiguous memory.
+class CovMatrix
+{
+ public:
+
+  /// Creates the matrix of n_series series without any observations
+  CovMatrix(size_t n_series=0)
+    : n_series_(n_series),
+      n_(0),
+      means_(n_series, 0.0),
+      comoments_(n_series * (n_series + 1) / 2, 0.0)
+  {}
+
+  /// Number of series
+  size_t n_series() const { return n_series_; }
+
+  /// Number of observations (rows) processed
+  size_t n_obs() const { return n_; }
+
+  /// The mean of the series i
+  double mean(size_t i) const { return means_[i]; }
+
+  /// The (unbiased) covariance of the series i and j
+  double cov(size_t i, size_t j) const
+  {
+    return n_ > 1 ? comoment(i, j) / (n_ - 1) : na::na<double>();
+  }
+
+  /// The correlation of the series i and j
+  double corr(size_t i, size_t j) const
+  {
+    return n_ > 1
+      ? comoment(i, j) / std::sqrt(comoment(i, i) * comoment(j, j))
+      : na::na<double>();
+  }
+
+  /// Adds n_rows observations given row by row, each row holding one value
+  /// per series, using n_threads threads (0 means one per core).
+  void add_block(const double* rows, size_t n_rows, size_t n_threads=1)
+  {
+    const size_t N = n_series_;
+    if (n_rows == 0 || N == 0) return;
+
+    // the means of the block and the deviations from them
+    std::vector<double> block_means(N, 0.0);
+    for (size_t r=0; r < n_rows; ++r) {
+      for (size_t j=0; j < N; ++j) block_means[j] += rows[r * N + j];
+    }
+    for (auto& m: block_means) m /= n_rows;
+    std::vector<double> dev(rows, rows + n_rows * N);
+    for (size_t r=0; r < n_rows; ++r) {
+      for (size_t j=0; j < N; ++j) dev[r * N + j] -= block_means[j];
+    }
+
+    // the difference of the means enters with the weight n_a n_b / n
+    std::vector<double> delta(N);
+    for (size_t j=0; j < N; ++j) delta[j] = block_means[j] - means_[j];
+    const double w = double(n_) * n_rows / (n_ + n_rows);
+
+    impl::parallel_for(N, n_threads, [&](size_t i) {
+      double* c = &comoments_[offset(i)]; // c[j - i] is the entry (i, j)
+      for (size_t r=0; r < n_rows; ++r) {
+        const double* d = &dev[r * N];
+        const double di = d[i];
+        for (size_t j=i; j < N; ++j) c[j - i] += di * d[j];
+      }
+      const double wi = w * delta[i];
+      for (size_t j=i; j < N; ++j) c[j - i] += wi * delta[j];
+    });
+
+    for (size_t j=0; j < N; ++j) {
+      means_[j] += delta[j] * n_rows / (n_ + n_rows);
+    }
+    n_ += n_rows;
+  }
+
+ private:
+
+  /// Position of the entry (i, i) in the packed matrix
+  size_t offset(size_t i) const { return i * (2 * n_series_ - i + 1) / 2; }
+
+  /// n times the covariance of the series i and j
+  double comoment(size_t i, size_t j) const
+  {
+    if (j < i) std::swap(i, j);
+    return comoments_[offset(i) + j - i];
+  }
+
+  size_t n_series_;               ///< Number of series
+  size_t n_;                      ///< Number of observations
+  std::vector<double> means_;     ///< The means of the series
+  std::vector<double> comoments_; ///< The packed upper triangle
+};
+
+
+/// Covariance matrix of a collection of series (e.g. SeriesCollection).
+///
+/// The series are aligned on their timestamps in one merge pass and only
+/// the timestamps where all the series have a value which is not NA are
+/// used. The rows are gathered in blocks of block_size and added to the
+/// matrix with CovMatrix::add_block() using n_threads threads.
+template<typename Series>
+CovMatrix cov_matrix(const std::vector<const Series*>& series,
+                     size_t n_threads=1, size_t block_size=1024)
+{
+  const size_t N = series.size();
+  CovMatrix res(N);
+  if (N == 0) return res;
+  if (block_size == 0) block_size = 1;
+  std::vector<double> block;
+  block.reserve(block_size * N);
+  auto row = AlignedMergeIterator<Series>::from_series_ptrs(series);
+  for (; row; ++row) {
+    if (row.present_series().size() < N) continue;
+    const auto& values = row.values();
+    if (std::any_of(values.begin(), values.end(),
+                    [](const typename Series::value_type& v) {
+                      return impl::skip(v);
+                    })) continue;
+    for (const auto& v: values) block.push_back(double(v));
+    if (block.size() == block_size * N) {
+      res.add_block(block.data(), block_size, n_threads);
+      block.clear();
+    }
+  }
+  res.add_block(block.data(), block.size() / N, n_threads);
+  return res;
+}
+
 } // namespace ts
 
 #endif /* COVARIANCE_HPP */
@@ -43,6 +43,12 @@ class SizeError: public TsException{
   using TsException::TsException;
 };
 
+/// Raised when a file cannot be read or written or has a wrong format.
+class IoError: public TsException{
+ public:
+  using TsException::TsException;
+};
+
 }
 
 #endif /* EXCEPTIONS_HPP */
@@ -4,7 +4,12 @@
 
 #include "filters/rolling_mean.hpp"
 #include "filters/rolling_median.hpp"
+#include "filters/rolling_quantiles.hpp"
+#include "filters/rolling_extremum.hpp"
+#include "filters/time_window.hpp"
+#include "filters/rolling_moments.hpp"
 #include "filters/online_moments.hpp"
+#include "filters/ewm.hpp"
 
 namespace ts {
 
@@ -18,6 +23,12 @@ namespace filters {
 // The namespace also contains
 // RollingMean;
 // RollingMedian<T=double>
+// RollingQuantiles<T=double>
+// RollingMin<T=double>, RollingMax<T=double>, RollingRange<T=double>
+// RollingVar, RollingStd, RollingCov, RollingCorr
+// TimeRollingMean<Timestamp, Duration=Timestamp>
+// TimeRollingMedian<Timestamp, T=double, Duration=Timestamp>
+// EwmMean<Timestamp=double>, EwmVar<Timestamp=double>, EwmCov<Timestamp=double>
 
 
 } // namespace filters
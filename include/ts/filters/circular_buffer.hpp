@@ -1,8 +1,9 @@
-// circular_buffer.hpp - circular buffer and the indirect comparison operator
+// circular_buffer.hpp - circular buffers and the indirect comparison operator
 
 #ifndef CIRCULAR_BUFFER_HPP
 #define CIRCULAR_BUFFER_HPP 
 
+#include <utility>
 #include <vector>
 
 namespace ts {
@@ -46,15 +47,9 @@ class CircularBuffer
   T write(T in)
   {
     auto oldVal = buf_[pos_];
-    if (!full_ && pos_ == 0) {
-      // first insertion ever
-      buf_[0] = in;
-      pos_ = 1;
-    } else {
-      buf_[pos_] = in;
-      pos_ = (pos_ + 1) % size();
-      full_ = full_ || pos_ == 0;
-    }
+    buf_[pos_] = in;
+    pos_ = (pos_ + 1) % size();
+    full_ = full_ || pos_ == 0;
     return oldVal;
   }
 
@@ -66,6 +61,92 @@ class CircularBuffer
    
 };
 
+/// A double-ended queue stored in a ring.
+///
+/// The capacity is a power of two given at the construction. Pushing into a
+/// full ring doubles the capacity, so a ring which never holds more than the
+/// initial capacity never allocates; otherwise the memory follows the largest
+/// number of elements held at once.
+template<typename T>
+class RingDeque
+{
+ public:
+  using value_type = T;
+
+  RingDeque(size_t capacity=16)
+    : buf_(round_up(capacity)),
+      mask_(buf_.size() - 1),
+      head_(0),
+      size_(0)
+  {}
+
+  /// Number of elements
+  size_t size() const { return size_; }
+
+  /// Current capacity
+  size_t capacity() const { return buf_.size(); }
+
+  /// Is the deque empty?
+  bool empty() const { return size_ == 0; }
+
+  /// Access operator counting from the front. No checks.
+  const T& operator[] (size_t index) const
+  {
+    return buf_[(head_ + index) & mask_];
+  }
+
+  /// First element. No checks.
+  const T& front() const { return buf_[head_]; }
+
+  /// Last element. No checks.
+  const T& back() const { return buf_[(head_ + size_ - 1) & mask_]; }
+
+  /// Adds an element at the end
+  void push_back(T in)
+  {
+    if (size_ == buf_.size()) grow();
+    buf_[(head_ + size_) & mask_] = in;
+    ++size_;
+  }
+
+  /// Removes the first element. No checks.
+  void pop_front()
+  {
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  /// Removes the last element. No checks.
+  void pop_back() { --size_; }
+
+ private:
+
+  std::vector<T> buf_;   ///< The buffer
+  size_t mask_;          ///< Capacity minus one
+  size_t head_;          ///< Position of the first element
+  size_t size_;          ///< Number of elements
+
+  /// The smallest power of two not less than n (and at least 1)
+  static size_t round_up(size_t n)
+  {
+    size_t res = 1;
+    while (res < n) res <<= 1;
+    return res;
+  }
+
+  /// Doubles the capacity moving the elements to the start of the buffer
+  void grow()
+  {
+    std::vector<T> buf(2 * buf_.size());
+    for (size_t i=0; i < size_; ++i) {
+      buf[i] = std::move(buf_[(head_ + i) & mask_]);
+    }
+    buf_.swap(buf);
+    mask_ = buf_.size() - 1;
+    head_ = 0;
+  }
+};
+
 /// Compare the indices w.r.t. to the values they point to
 template<class Values, class Compare=std::less<typename Values::value_type> >
 class CompareReferencedValues
@@ -0,0 +1,67 @@
+// compensated_sum.hpp - running sum with compensation of rounding errors
+
+#ifndef COMPENSATED_SUM_HPP
+#define COMPENSATED_SUM_HPP
+
+#include <cmath>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// A running sum keeping track of its own rounding error.
+///
+/// Uses the Kahan-Babuska (Neumaier) variant of the compensated summation
+/// which also handles the terms larger than the running sum. The error of
+/// the result does not grow with the number of terms (up to a second order
+/// term), so a sum to which values are added and from which they are
+/// subtracted forever does not drift. See
+///
+/// Neumaier, A. (1974). "Rundungsfehleranalyse einiger Verfahren zur
+/// Summation endlicher Summen". ZAMM 54(1):39-51.
+///
+class CompensatedSum
+{
+ public:
+
+  CompensatedSum(double init=0)
+    : sum_(init),
+      comp_(0)
+  {}
+
+  /// The current value of the sum
+  double value() const { return sum_ + comp_; }
+
+  /// Adds a term
+  void add(double x)
+  {
+    auto t = sum_ + x;
+    if (std::abs(sum_) >= std::abs(x)) {
+      comp_ += (sum_ - t) + x;
+    } else {
+      comp_ += (x - t) + sum_;
+    }
+    sum_ = t;
+  }
+
+  /// Adds a term
+  CompensatedSum& operator+= (double x) { add(x); return *this; }
+
+  /// Subtracts a term
+  CompensatedSum& operator-= (double x) { add(-x); return *this; }
+
+ private:
+  double sum_;  ///< The naive running sum
+  double comp_; ///< The accumulated rounding errors
+};
+
+} // namespace impl
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* COMPENSATED_SUM_HPP */
@@ -0,0 +1,325 @@
+// ewm.hpp - exponentially weighted moving mean, variance and covariance
+
+#ifndef EWM_HPP
+#define EWM_HPP
+
+#include <cmath>
+#include <utility>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/filters/validity.hpp>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// The weight of a new observation in an exponentially weighted average.
+///
+/// Either a constant weight alpha per observation or a weight decaying with
+/// the time elapsed since the previous observation so that the weights of
+/// the past observations halve every halflife time units. Without the
+/// timestamps the half-life is measured in observations.
+///
+/// The observations with the same timestamp (e.g. a burst of ticks) get
+/// equal weights: the result is as if they all arrived at once with the
+/// weight of a single observation each, so none of them is dropped and
+/// their order does not matter for the mean.
+template<typename Timestamp>
+class EwmDecay
+{
+ public:
+
+  /// Constant weight alpha of each new observation
+  static EwmDecay from_alpha(double alpha)
+  {
+    if (!(alpha > 0 && alpha <= 1))
+      throw TsException("EwmDecay: alpha must be in (0, 1]");
+    return EwmDecay(alpha, 0);
+  }
+
+  /// The weights of the past observations halve every halflife time units
+  static EwmDecay from_halflife(double halflife)
+  {
+    if (!(halflife > 0))
+      throw TsException("EwmDecay: halflife must be positive");
+    return EwmDecay(1 - std::exp(-std::log(2.0) / halflife), halflife);
+  }
+
+  /// The weight of a new observation without a timestamp
+  double weight() const { return alpha_; }
+
+  /// The weight of a new observation at time t
+  double weight(Timestamp t)
+  {
+    if (halflife_ == 0) return alpha_;
+    if (started_ && !(last_ < t)) {
+      // one more observation weighing as much as the last one
+      total_ += 1;
+      return 1 / total_;
+    }
+    double a = started_
+      ? 1 - std::exp(-std::log(2.0) * double(t - last_) / halflife_)
+      : 1;
+    started_ = true;
+    last_ = t;
+    total_ = 1 / a;
+    return a;
+  }
+
+ private:
+
+  EwmDecay(double alpha, double halflife)
+    : alpha_(alpha),
+      halflife_(halflife),
+      started_(false),
+      last_(),
+      total_(1)
+  {}
+
+  double alpha_;     ///< Weight per observation
+  double halflife_;  ///< The half-life in time units or 0
+  bool started_;     ///< Was a timestamp already seen?
+  Timestamp last_;   ///< The timestamp of the previous observation
+  double total_;     ///< Total weight in units of the last observation's
+};
+
+} // namespace impl
+
+
+/// Exponentially weighted moving average.
+///
+/// The mean is updated as mean += a (x - mean) where a is either a constant
+/// alpha or, for the filters constructed by from_halflife() and fed
+/// (timestamp, value) pairs, depends on the time elapsed since the previous
+/// observation (the observations at the same time get equal weights, see
+/// impl::EwmDecay). The first observation initializes the mean. NA inputs
+/// are skipped.
+template<typename Timestamp=double>
+class EwmMean: public DeterministicallyValidFilter
+{
+ public:
+  typedef double input_type;
+  typedef double output_type;
+
+  /// Constant weight alpha in (0, 1] of each new observation
+  EwmMean(double alpha)
+    : EwmMean(impl::EwmDecay<Timestamp>::from_alpha(alpha))
+  {}
+
+  /// The weights of the past observations halve every halflife time units
+  static EwmMean from_halflife(double halflife)
+  {
+    return EwmMean(impl::EwmDecay<Timestamp>::from_halflife(halflife));
+  }
+
+  /// Returns the current estimate
+  double value() const { return ready() ? mu_ : na::na<double>(); }
+
+  /// Processes the next value
+  double operator() (double x)
+  {
+    return update(decay_.weight(), x);
+  }
+
+  /// Processes the next value observed at time t
+  double operator() (Timestamp t, double x)
+  {
+    if (na::is_na(x)) return value();
+    return update(decay_.weight(t), x);
+  }
+
+ private:
+
+  explicit EwmMean(impl::EwmDecay<Timestamp> decay)
+    : DeterministicallyValidFilter(1),
+      decay_(decay)
+  {}
+
+  double update(double a, double x)
+  {
+    if (na::is_na(x)) return value();
+    CountingFilter::inc();
+    if (n_processed() == 1) a = 1;
+    mu_ += a * (x - mu_);
+    return mu_;
+  }
+
+  impl::EwmDecay<Timestamp> decay_; ///< The weights of new observations
+  double mu_ = 0;                   ///< current estimate
+};
+
+
+/// Exponentially weighted moving variance.
+///
+/// Uses the incremental update of the weighted mean and variance given by
+/// equations (143) and (144) in
+///
+/// Finch, T. (2009). "Incremental calculation of weighted mean and variance".
+/// University of Cambridge.
+///
+/// The weights of new observations are set as in EwmMean. NA inputs are
+/// skipped.
+template<typename Timestamp=double>
+class EwmVar: public DeterministicallyValidFilter
+{
+ public:
+  typedef double input_type;
+  typedef double output_type;
+
+  /// Constant weight alpha in (0, 1] of each new observation
+  EwmVar(double alpha)
+    : EwmVar(impl::EwmDecay<Timestamp>::from_alpha(alpha))
+  {}
+
+  /// The weights of the past observations halve every halflife time units
+  static EwmVar from_halflife(double halflife)
+  {
+    return EwmVar(impl::EwmDecay<Timestamp>::from_halflife(halflife));
+  }
+
+  /// Returns the current estimate of the variance
+  double value() const { return ready() ? var_ : na::na<double>(); }
+
+  /// Returns the current estimate of the mean
+  double mean() const { return mu_; }
+
+  /// Processes the next value
+  double operator() (double x)
+  {
+    return update(decay_.weight(), x);
+  }
+
+  /// Processes the next value observed at time t
+  double operator() (Timestamp t, double x)
+  {
+    if (na::is_na(x)) return value();
+    return update(decay_.weight(t), x);
+  }
+
+ private:
+
+  explicit EwmVar(impl::EwmDecay<Timestamp> decay)
+    : DeterministicallyValidFilter(2),
+      decay_(decay)
+  {}
+
+  double update(double a, double x)
+  {
+    if (na::is_na(x)) return value();
+    CountingFilter::inc();
+    if (n_processed() == 1) a = 1;
+    auto delta = x - mu_;
+    auto incr = a * delta;
+    mu_ += incr;
+    var_ = (1 - a) * (var_ + delta * incr);
+    return value();
+  }
+
+  impl::EwmDecay<Timestamp> decay_; ///< The weights of new observations
+  double mu_ = 0;                   ///< current estimate of the mean
+  double var_ = 0;                  ///< current estimate of the variance
+};
+
+
+/// Exponentially weighted moving covariance of two inputs.
+///
+/// The two-dimensional version of EwmVar. The inputs are passed either as
+/// two values or as a pair, optionally preceded by a timestamp. The
+/// observations where any of the inputs is NA are skipped.
+template<typename Timestamp=double>
+class EwmCov: public DeterministicallyValidFilter
+{
+ public:
+  typedef std::pair<double, double> input_type;
+  typedef double output_type;
+
+  /// Constant weight alpha in (0, 1] of each new observation
+  EwmCov(double alpha)
+    : EwmCov(impl::EwmDecay<Timestamp>::from_alpha(alpha))
+  {}
+
+  /// The weights of the past observations halve every halflife time units
+  static EwmCov from_halflife(double halflife)
+  {
+    return EwmCov(impl::EwmDecay<Timestamp>::from_halflife(halflife));
+  }
+
+  /// Returns the current estimate of the covariance
+  double value() const { return ready() ? cov_ : na::na<double>(); }
+
+  /// current estimate of the covariance
+  double cov() const { return cov_; }
+
+  /// current estimate of the variance of the first input
+  double var1() const { return var1_; }
+
+  /// current estimate of the variance of the second input
+  double var2() const { return var2_; }
+
+  /// current estimate of the correlation
+  double corr() const { return cov_ / std::sqrt(var1_ * var2_); }
+
+  /// Processes the next values
+  double operator() (double x1, double x2)
+  {
+    return update(decay_.weight(), x1, x2);
+  }
+
+  /// Processes the next values
+  double operator() (const input_type& x)
+  {
+    return update(decay_.weight(), x.first, x.second);
+  }
+
+  /// Processes the next values observed at time t
+  double operator() (Timestamp t, double x1, double x2)
+  {
+    if (na::is_na(x1) || na::is_na(x2)) return value();
+    return update(decay_.weight(t), x1, x2);
+  }
+
+  /// Processes the next values observed at time t
+  double operator() (Timestamp t, const input_type& x)
+  {
+    return operator()(t, x.first, x.second);
+  }
+
+ private:
+
+  explicit EwmCov(impl::EwmDecay<Timestamp> decay)
+    : DeterministicallyValidFilter(2),
+      decay_(decay)
+  {}
+
+  double update(double a, double x1, double x2)
+  {
+    if (na::is_na(x1) || na::is_na(x2)) return value();
+    CountingFilter::inc();
+    if (n_processed() == 1) a = 1;
+    auto delta1 = x1 - m1_;
+    auto delta2 = x2 - m2_;
+    m1_ += a * delta1;
+    m2_ += a * delta2;
+    var1_ = (1 - a) * (var1_ + a * delta1 * delta1);
+    var2_ = (1 - a) * (var2_ + a * delta2 * delta2);
+    cov_ = (1 - a) * (cov_ + a * delta1 * delta2);
+    return value();
+  }
+
+  impl::EwmDecay<Timestamp> decay_; ///< The weights of new observations
+  double m1_ = 0;   ///< current estimate of the mean of the first input
+  double m2_ = 0;   ///< current estimate of the mean of the second input
+  double var1_ = 0; ///< current estimate of the variance of the first input
+  double var2_ = 0; ///< current estimate of the variance of the second input
+  double cov_ = 0;  ///< current estimate of the covariance
+};
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* EWM_HPP */
@@ -5,6 +5,7 @@
 
 #include <cmath>
 
+#include <ts/na.hpp>
 #include <ts/filters/validity.hpp>
 
 
@@ -14,11 +15,145 @@ namespace filters {
 
 namespace impl {
 
-double secondMomentDenominator(size_t n, bool besselCorrection)
+inline double secondMomentDenominator(size_t n, bool besselCorrection)
 {
   return besselCorrection ? n-1 : n;
 }
 
+/// The number of observations, the mean and the sum of squared distances
+/// from the mean of a sequence.
+struct Moments
+{
+  size_t n = 0;  ///< number of observations
+  double m = 0;  ///< the mean
+  double M2 = 0; ///< sum of squared distances from the mean
+
+  /// Combines with the moments of another sequence using the parallel
+  /// update from
+  ///
+  /// Chan, T. F., Golub, G. H., LeVeque, R. J. (1979). "Updating formulae
+  /// and a pairwise algorithm for computing sample variances". Technical
+  /// Report STAN-CS-79-773, Stanford University.
+  ///
+  void merge(const Moments& other)
+  {
+    if (other.n == 0) return;
+    if (n == 0) { *this = other; return; }
+    size_t total = n + other.n;
+    double delta = other.m - m;
+    double w = double(other.n) / total;
+    m += delta * w;
+    M2 += other.M2 + delta * delta * n * w;
+    n = total;
+  }
+};
+
+/// Number of values reduced at once by the block kernels. A block fits
+/// in the L1 cache so that its second pass does not touch the memory.
+constexpr size_t moments_block_size = 1024;
+
+/// Number of independent partial sums in the block kernels. They let the
+/// compiler keep the sums in the lanes of a vector register without
+/// reassociating the floating point additions.
+constexpr size_t moments_lanes = 8;
+
+/// Is the value present? NAs are skipped only for the types having them.
+template<typename T>
+inline bool present(T x)
+{
+  return !na::can_na<T>() || x == x;
+}
+
+/// Count and sum of a block of values skipping NAs.
+template<typename T>
+void block_sum(const T* first, const T* last, size_t& count, double& sum)
+{
+  double s[moments_lanes] = {};
+  size_t c[moments_lanes] = {};
+  const size_t n = last - first;
+  const size_t nfull = n - n % moments_lanes;
+  for (size_t i=0; i < nfull; i += moments_lanes) {
+    for (size_t l=0; l < moments_lanes; ++l) {
+      auto x = first[i + l];
+      bool ok = present(x);
+      s[l] += ok ? double(x) : 0.0;
+      c[l] += ok;
+    }
+  }
+  for (size_t i=nfull; i < n; ++i) {
+    bool ok = present(first[i]);
+    s[0] += ok ? double(first[i]) : 0.0;
+    c[0] += ok;
+  }
+  count = 0;
+  sum = 0;
+  for (size_t l=0; l < moments_lanes; ++l) {
+    count += c[l];
+    sum += s[l];
+  }
+}
+
+/// Sum of squared distances of a block of values from m skipping NAs.
+template<typename T>
+double block_sum_sq(const T* first, const T* last, double m)
+{
+  double s[moments_lanes] = {};
+  const size_t n = last - first;
+  const size_t nfull = n - n % moments_lanes;
+  for (size_t i=0; i < nfull; i += moments_lanes) {
+    for (size_t l=0; l < moments_lanes; ++l) {
+      auto x = first[i + l];
+      auto d = double(x) - m;
+      s[l] += present(x) ? d * d : 0.0;
+    }
+  }
+  for (size_t i=nfull; i < n; ++i) {
+    auto d = double(first[i]) - m;
+    s[0] += present(first[i]) ? d * d : 0.0;
+  }
+  double res = 0;
+  for (size_t l=0; l < moments_lanes; ++l) res += s[l];
+  return res;
+}
+
+/// The moments of the values in [first, last) skipping NAs.
+///
+/// Each block of moments_block_size values is reduced with the two-pass
+/// algorithm by the vectorizable kernels above and the blocks are combined
+/// with Moments::merge() as the leaves of a balanced binary tree, so the
+/// rounding error grows with the logarithm of the number of blocks like in
+/// a pairwise summation rather than linearly like in a long running sum.
+template<typename T>
+Moments block_moments(const T* first, const T* last, bool second=true)
+{
+  // levels[l] holds the merge of 2^l blocks when the bit l of n_blocks is
+  // set, the carries merge the equal subtrees as in a binary counter
+  Moments levels[64];
+  size_t n_blocks = 0;
+  for (auto b = first; b < last; b += moments_block_size) {
+    auto e = last - b > ptrdiff_t(moments_block_size)
+             ? b + moments_block_size : last;
+    Moments block;
+    double sum;
+    block_sum(b, e, block.n, sum);
+    if (block.n == 0) continue;
+    block.m = sum / block.n;
+    if (second) block.M2 = block_sum_sq(b, e, block.m);
+    size_t l = 0;
+    for (; (n_blocks >> l) & 1; ++l) {
+      levels[l].merge(block);
+      block = levels[l];
+    }
+    levels[l] = block;
+    ++n_blocks;
+  }
+  Moments res;
+  for (size_t l = 64; l-- > 0; ) {
+    if ((n_blocks >> l) & 1) res.merge(levels[l]);
+  }
+  return res;
+}
+
 } // namespace impl
 
 
@@ -57,6 +192,37 @@ class OnlineMean: public DeterministicallyValidFilter
     return mu_;
   }
 
+  /// Processes the values in [first, last) skipping NAs (batch version
+  /// of operator() using the vectorizable block reductions)
+  template<typename T>
+  double process(const T* first, const T* last)
+  {
+    merge_moments(impl::block_moments(first, last, false));
+    return mu_;
+  }
+
+  /// Combines with an estimator which processed other values so that the
+  /// result is as if this estimator processed all of them.
+  void merge(const OnlineMean& other)
+  {
+    impl::Moments m;
+    m.n = other.n_processed();
+    m.m = other.mu_;
+    merge_moments(m);
+  }
+
+ private:
+
+  /// Combines with the moments of other values
+  void merge_moments(const impl::Moments& other)
+  {
+    impl::Moments self;
+    self.n = n_processed();
+    self.m = mu_;
+    self.merge(other);
+    CountingFilter::inc(other.n);
+    mu_ = self.m;
+  }
 };
 
 
@@ -105,6 +271,40 @@ class OnlineVarUnknownMean: public DeterministicallyValidFilter
     mu_ += delta / n_processed();
     M2_ += delta * (x - mu_);
   }
+
+  /// Processes the values in [first, last) skipping NAs (batch version
+  /// of operator() using the vectorizable block reductions)
+  template<typename T>
+  void process(const T* first, const T* last)
+  {
+    merge_moments(impl::block_moments(first, last));
+  }
+
+  /// Combines with an estimator which processed other values so that the
+  /// result is as if this estimator processed all of them.
+  void merge(const OnlineVarUnknownMean& other)
+  {
+    impl::Moments m;
+    m.n = other.n_processed();
+    m.m = other.mu_;
+    m.M2 = other.M2_;
+    merge_moments(m);
+  }
+
+ private:
+
+  /// Combines with the moments of other values
+  void merge_moments(const impl::Moments& other)
+  {
+    impl::Moments self;
+    self.n = n_processed();
+    self.m = mu_;
+    self.M2 = M2_;
+    self.merge(other);
+    CountingFilter::inc(other.n);
+    mu_ = self.m;
+    M2_ = self.M2;
+  }
 };
 
 
@@ -170,6 +370,24 @@ class OnlineCovUnknownMeans: public DeterministicallyValidFilter
     // M12_ += (x2 - mu2_) * delta1; // also works
  
   }
+
+  /// Combines with an estimator which processed other values so that the
+  /// result is as if this estimator processed all of them. The
+  /// two-dimensional version of impl::Moments::merge().
+  void merge(const OnlineCovUnknownMeans& other)
+  {
+    size_t na = n_processed(), nb = other.n_processed();
+    if (nb == 0) return;
+    double w = double(nb) / (na + nb);
+    double delta1 = other.m1_ - m1_;
+    double delta2 = other.m2_ - m2_;
+    m1_ += delta1 * w;
+    m2_ += delta2 * w;
+    M11_ += other.M11_ + delta1 * delta1 * na * w;
+    M22_ += other.M22_ + delta2 * delta2 * na * w;
+    M12_ += other.M12_ + delta1 * delta2 * na * w;
+    CountingFilter::inc(nb);
+  }
 };
 
 
@@ -0,0 +1,197 @@
+// rolling_extremum.hpp - rolling minimum, maximum and range
+
+#ifndef ROLLING_EXTREMUM_HPP
+#define ROLLING_EXTREMUM_HPP
+
+#include <functional>
+#include <utility>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/filters/circular_buffer.hpp>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// The extremum of a sliding window using a monotonic deque.
+///
+/// The deque holds the candidates for the extremum, i.e. the observations
+/// of the window not followed by a better or equal (w.r.t. Compare) one,
+/// together with their sequence numbers. The candidates thus go from the
+/// best one at the front to the newest one at the back. A new observation
+/// removes the candidates it beats from the back and the front one is
+/// removed once it leaves the window. Each observation enters and leaves
+/// the deque once so the work is amortized O(1). The deque never holds more
+/// than window_size elements and does not allocate after the construction.
+template<typename T, class Compare>
+class MonotonicWindow
+{
+ public:
+
+  MonotonicWindow(size_t window_size, const Compare& comp=Compare())
+    : window_size_(window_size),
+      n_(0),
+      deque_(window_size),
+      comp_(comp)
+  {
+    if (window_size < 1)
+      throw TsException(
+          "MonotonicWindow(): window_size must be at least 1"
+      );
+  }
+
+  /// Is the window full?
+  bool full() const { return n_ >= window_size_; }
+
+  /// The extremum of the current window. No checks.
+  T value() const { return deque_.front().second; }
+
+  /// Puts the new observation in the window
+  void operator() (T in)
+  {
+    // the front leaves the window when the n_-th observation enters
+    if (!deque_.empty() && deque_.front().first + window_size_ <= n_) {
+      deque_.pop_front();
+    }
+    while (!deque_.empty() && !comp_(deque_.back().second, in)) {
+      deque_.pop_back();
+    }
+    deque_.push_back(std::make_pair(n_, in));
+    ++n_;
+  }
+
+ private:
+  size_t window_size_;                     ///< The window size
+  size_t n_;                               ///< Number of processed values
+  RingDeque<std::pair<size_t, T> > deque_; ///< The candidates
+  Compare comp_;                           ///< Is the first value better?
+};
+
+} // namespace impl
+
+
+/// Rolling minimum using a monotonic deque (amortized O(1) per update).
+///
+/// The filter is considered to be ready to provide an ouput only when
+/// the window_size observations has been processed. Until then the output
+/// is NA (or T() for the types without NA).
+template<typename T=double>
+class RollingMin
+{
+ public:
+  typedef T input_type;
+  typedef T output_type;
+
+  /// Constructs the filter with a given window size
+  RollingMin(size_t window_size)
+    : min_(window_size)
+  {}
+
+  /// Are we ready to provide the output?
+  bool ready() const { return min_.full(); }
+
+  /// Returns the current minimum
+  T value() const { return ready() ? min_.value() : na::na_or_default<T>(); }
+
+  /// Puts the new observation in the window and returns the minimum
+  T operator() (T in)
+  {
+    min_(in);
+    return value();
+  }
+
+ private:
+  impl::MonotonicWindow<T, std::less<T> > min_;
+};
+
+
+/// Rolling maximum using a monotonic deque (amortized O(1) per update).
+///
+/// The filter is considered to be ready to provide an ouput only when
+/// the window_size observations has been processed. Until then the output
+/// is NA (or T() for the types without NA).
+template<typename T=double>
+class RollingMax
+{
+ public:
+  typedef T input_type;
+  typedef T output_type;
+
+  /// Constructs the filter with a given window size
+  RollingMax(size_t window_size)
+    : max_(window_size)
+  {}
+
+  /// Are we ready to provide the output?
+  bool ready() const { return max_.full(); }
+
+  /// Returns the current maximum
+  T value() const { return ready() ? max_.value() : na::na_or_default<T>(); }
+
+  /// Puts the new observation in the window and returns the maximum
+  T operator() (T in)
+  {
+    max_(in);
+    return value();
+  }
+
+ private:
+  impl::MonotonicWindow<T, std::greater<T> > max_;
+};
+
+
+/// Rolling range (maximum minus minimum) using two monotonic deques.
+///
+/// The filter is considered to be ready to provide an ouput only when
+/// the window_size observations has been processed. Until then the output
+/// is NA (or T() for the types without NA).
+template<typename T=double>
+class RollingRange
+{
+ public:
+  typedef T input_type;
+  typedef T output_type;
+
+  /// Constructs the filter with a given window size
+  RollingRange(size_t window_size)
+    : min_(window_size),
+      max_(window_size)
+  {}
+
+  /// Are we ready to provide the output?
+  bool ready() const { return min_.full(); }
+
+  /// Returns the current range
+  T value() const
+  {
+    return ready() ? max_.value() - min_.value() : na::na_or_default<T>();
+  }
+
+  /// The minimum of the current window. No readiness checks.
+  T min() const { return min_.value(); }
+
+  /// The maximum of the current window. No readiness checks.
+  T max() const { return max_.value(); }
+
+  /// Puts the new observation in the window and returns the range
+  T operator() (T in)
+  {
+    min_(in);
+    max_(in);
+    return value();
+  }
+
+ private:
+  impl::MonotonicWindow<T, std::less<T> > min_;
+  impl::MonotonicWindow<T, std::greater<T> > max_;
+};
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* ROLLING_EXTREMUM_HPP */
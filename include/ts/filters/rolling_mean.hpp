@@ -8,6 +8,7 @@
 #include <ts/exceptions.hpp>
 #include <ts/na.hpp>
 #include <ts/filters/circular_buffer.hpp>
+#include <ts/filters/compensated_sum.hpp>
 
 
 namespace ts {
@@ -16,6 +17,10 @@ namespace filters {
 
 /// Simple moving average using a circular buffer.
 ///
+/// The sum of the window is updated by adding the new value and subtracting
+/// the oldest one using a compensated summation so that the mean does not
+/// drift away from the exact one in long-running processes.
+///
 /// The filter is considered to be ready to provide an ouput only when
 /// the window_size observations has been processed. To have expanding
 /// window behavior one could add another parameter min_window_size so
@@ -30,13 +35,14 @@ class RollingMean
   
   /// Constructs the RollingMean filter
   RollingMean(size_t window_size):
-    mean_(0),
-    k_(1.0 / window_size),
     buf(window_size)
   {}
 
   /// Returns the current value of the mean
-  double value() const { return ready() ? mean_ : na::na<double>();  }
+  double value() const
+  {
+    return ready() ? sum_.value() / buf.size() : na::na<double>();
+  }
 
   /// Are we ready to provide the output?
   bool ready() const { return buf.full(); }
@@ -46,17 +52,18 @@ class RollingMean
   {
     if (buf.full()) {
       auto valOut = buf.write(valIn);
-      mean_ += k_ * (valIn - valOut);
+      sum_ += valIn;
+      sum_ -= valOut;
     } else {
       buf.write(valIn);
-      mean_ += k_ * valIn;
+      sum_ += valIn;
     }
-    return mean_;
+    // the sum divided by the window size even before the window is full
+    return sum_.value() / buf.size();
   }
   
  private:
-  double mean_;
-  double k_;
+  impl::CompensatedSum sum_;
   impl::CircularBuffer<double> buf;
 };
 
@@ -1,11 +1,11 @@
 // rolling_median.hpp - implementation of a rolling median
 
 #ifndef ROLLING_MEDIAN_HPP
-#define ROLLING_MEDIAN_HPP 
+#define ROLLING_MEDIAN_HPP
 
-#include <typeinfo>
+#include <functional>
+#include <limits>
 #include <vector>
-#include <set>
 #include <iostream>
 
 #include <ts/exceptions.hpp>
@@ -19,39 +19,141 @@ namespace filters {
 
 namespace impl {
 
-/// A (sorted) multiset with convenience methods.
-template<typename T, class Compare>
-class MultiSet: public std::multiset<T, Compare>
+/// A binary heap of buffer positions (slots) ordered by the values stored
+/// at these positions.
+///
+/// The heap keeps track of where each slot is located so that a slot whose
+/// value has been overwritten can be moved to its new place in O(log n).
+/// The values are not owned by the heap and are passed to every method which
+/// needs to compare them; this way the heap holds no references and can be
+/// freely copied together with the buffer. All the memory is allocated in
+/// the constructor.
+///
+/// The top of the heap is the slot whose value v satisfies !comp(w, v) for
+/// all the other values w, i.e. std::less gives a min-heap.
+template<typename T, class Compare=std::less<T> >
+class IndexedHeap
 {
  public:
-  MultiSet(const Compare& comp)
-    : std::multiset<T, Compare>(comp)
-  {}
-
-  /// First element
-  T first() const { return *(this->begin()); }
-
-  /// Last element
-  T last() const { return *(--this->end()); }
-  
-  /// Removes a first occurence of a given value
-  ///
-  /// The method is different from multiset::erase(val) which removes
-  /// all the elements identical to the given one w.r.t. to the comparison
-  bool remove_first(T val)
+
+  /// Marks the slots which are not in the heap.
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /// Constructs an empty heap able to hold capacity slots out of n_slots.
+  IndexedHeap(size_t n_slots, size_t capacity, const Compare& comp=Compare())
+    : where_(n_slots, npos),
+      comp_(comp)
   {
-    auto it = this->begin();
-    while (it != this->end()) {
-      if (*it == val) {
-        this->erase(it);
-        return true;
-      }
-      ++it;
+    heap_.reserve(capacity);
+  }
+
+  /// Number of slots in the heap
+  size_t size() const { return heap_.size(); }
+
+  /// Is the heap empty?
+  bool empty() const { return heap_.empty(); }
+
+  /// The slot at the top of the heap
+  size_t top() const { return heap_.front(); }
+
+  /// Is the slot in the heap?
+  bool contains(size_t slot) const { return where_[slot] != npos; }
+
+  /// Iterators over the slots (in the heap order)
+  auto cbegin() const -> decltype(auto) { return heap_.cbegin(); }
+  auto cend() const -> decltype(auto) { return heap_.cend(); }
+
+  /// Adds a slot to the heap
+  template<class Values>
+  void push(size_t slot, const Values& values)
+  {
+    heap_.push_back(slot);
+    where_[slot] = heap_.size() - 1;
+    sift_up(heap_.size() - 1, values);
+  }
+
+  /// Removes the top slot from the heap and returns it
+  template<class Values>
+  size_t pop(const Values& values)
+  {
+    auto slot = heap_.front();
+    move(heap_.size() - 1, 0);
+    heap_.pop_back();
+    where_[slot] = npos;
+    if (!heap_.empty()) sift_down(0, values);
+    return slot;
+  }
+
+  /// Restores the heap order after the value of a slot has changed
+  template<class Values>
+  void update(size_t slot, const Values& values)
+  {
+    sift_down(sift_up(where_[slot], values), values);
+  }
+
+ private:
+
+  std::vector<size_t> heap_;  ///< The slots in the heap order
+  std::vector<size_t> where_; ///< Position of each slot in heap_ or npos
+  Compare comp_;              ///< Comparison of the values
+
+  /// Does the slot at heap position i belong above the one at position j?
+  template<class Values>
+  bool above(size_t i, size_t j, const Values& values) const
+  {
+    return comp_(values[heap_[i]], values[heap_[j]]);
+  }
+
+  /// Moves the slot at heap position from to heap position to
+  void move(size_t from, size_t to)
+  {
+    heap_[to] = heap_[from];
+    where_[heap_[to]] = to;
+  }
+
+  /// Swaps the slots at the given heap positions
+  void swap(size_t i, size_t j)
+  {
+    std::swap(heap_[i], heap_[j]);
+    where_[heap_[i]] = i;
+    where_[heap_[j]] = j;
+  }
+
+  /// Moves the slot at the heap position i up; returns its new position
+  template<class Values>
+  size_t sift_up(size_t i, const Values& values)
+  {
+    while (i > 0) {
+      auto parent = (i - 1) / 2;
+      if (!above(i, parent, values)) break;
+      swap(i, parent);
+      i = parent;
+    }
+    return i;
+  }
+
+  /// Moves the slot at the heap position i down; returns its new position
+  template<class Values>
+  size_t sift_down(size_t i, const Values& values)
+  {
+    const size_t n = heap_.size();
+    while (true) {
+      auto best = i;
+      auto left = 2 * i + 1;
+      auto right = left + 1;
+      if (left < n && above(left, best, values)) best = left;
+      if (right < n && above(right, best, values)) best = right;
+      if (best == i) break;
+      swap(i, best);
+      i = best;
     }
-    return false;
+    return i;
   }
 };
 
+template<typename T, class Compare>
+constexpr size_t IndexedHeap<T, Compare>::npos;
+
 /// Prints the mapping from the indices to the values
 template<class Indices, class Values>
 void print_map(
@@ -70,15 +172,21 @@ void print_map(
 /// Rolling median filter
 ///
 /// The data in the current window is stored in a circular buffer (valuesBuf).
-/// The index of each element belongs to one of the two sets: upperInds and
-/// lowerInds. Both sets are sorted so that the values referenced by the
-/// consequent indices are nondecreasing and the values referenced by
-/// lowerInds are not greater than those referenced by upperInds.
+/// The position of each element in the buffer belongs to one of the two
+/// heaps: lowerInds (a max-heap) and upperInds (a min-heap). The values
+/// referenced by lowerInds are not greater than those referenced by
+/// upperInds.
 ///
-/// Moreover, the numbers of elements in both sets are either equal or
+/// Moreover, the numbers of elements in both heaps are either equal or
 /// lowerInds have one element more. The median equals either the average of
-/// the valuesBuf[last(lowerInds)] and valuesBuf[first(upperInds)] or
-/// valuesBuf[last(lowerInds)].
+/// the valuesBuf[top(lowerInds)] and valuesBuf[top(upperInds)] or
+/// valuesBuf[top(lowerInds)].
+///
+/// Once the window is full the new value overwrites the oldest one in the
+/// same buffer position. The position then stays in its heap and is only
+/// sifted to its new place, followed by at most one exchange of the tops of
+/// the heaps. Every update is thus O(log window_size) and no memory is
+/// allocated after the construction.
 ///
 /// The filter is considered to be ready to provide an ouput only when
 /// the window_size observations has been processed. To have expanding
@@ -96,22 +204,20 @@ class RollingMedian
  private:
 
   using CircularBuffer = impl::CircularBuffer<T>;
-  using ValuesLess = impl::CompareReferencedValues<CircularBuffer>;
-  using IndexSet = impl::MultiSet<size_t, ValuesLess>;
+  using LowerHeap = impl::IndexedHeap<T, std::greater<T> >;
+  using UpperHeap = impl::IndexedHeap<T, std::less<T> >;
 
   CircularBuffer valuesBuf; ///< Circular buffer of values
-  ValuesLess valuesLess; ///< Compares values given indices
-  IndexSet upperInds; ///< The indices of values below or equal to the median
-  IndexSet lowerInds; ///< The indices of values above the median
+  LowerHeap lowerInds; ///< The positions of values below or equal to the median
+  UpperHeap upperInds; ///< The positions of values above the median
 
  public:
 
   /// Constructs a rolling median filter with a given window size
   RollingMedian(size_t window_size)
     : valuesBuf(window_size),
-      valuesLess(valuesBuf), // compares the values given indices
-      upperInds(valuesLess), // initialize the sets
-      lowerInds(valuesLess)
+      lowerInds(window_size, window_size / 2 + 1),
+      upperInds(window_size, window_size / 2 + 1)
   {
     if (window_size < 2)
       throw TsException(
@@ -119,14 +225,6 @@ class RollingMedian
       );
   }
 
-  /// Need a copy ctor because the comparator references the values buffer.
-  RollingMedian(const RollingMedian& f)
-    : valuesBuf(f.valuesBuf),
-      valuesLess(valuesBuf), // reinitialize with the new buffer!!!
-      upperInds(valuesLess),
-      lowerInds(valuesLess)
-  {}
-
   /// Is the buffer already full?
   bool ready() const { return valuesBuf.full(); }
 
@@ -134,50 +232,39 @@ class RollingMedian
   T value() const
   {
     if (!ready()) return na::na<T>();
-  /// Returns the current value of the mean
-    int k = upperInds.size() - lowerInds.size();
-    if (k == 0) {
-      return (valuesBuf[upperInds.first()]
-            + valuesBuf[lowerInds.last()]) / 2.0;
-    }
-    else if (k > 0)
-      return valuesBuf[upperInds.first()];
-    else if (k < 0)
-      return valuesBuf[lowerInds.last()];
-    else {
-      // should not happen
-      throw TsException(
-        "Difference of sizes of upperInds and lowerInds sets > 2"
-      );
+    if (lowerInds.size() == upperInds.size()) {
+      return (valuesBuf[lowerInds.top()]
+            + valuesBuf[upperInds.top()]) / 2.0;
     }
+    return valuesBuf[lowerInds.top()];
   }
-  
+
   /// Put the new observation in and return the updated median
   T operator() (T in)
   {
-    if (valuesBuf.count() == 0) {
-      // first insertion ever
+    auto pos = valuesBuf.pos();
+    if (valuesBuf.full()) {
+      // the new value replaces the oldest one in the same position
       valuesBuf.write(in);
-      upperInds.insert(0);
-    } else {
-      // any other update
-      auto pos = valuesBuf.pos();
-      auto old_med = value();
-      // remove the reference to the old value
-      if (valuesBuf.full()) {
-        upperInds.remove_first(pos);
-        lowerInds.remove_first(pos);
+      if (lowerInds.contains(pos)) {
+        lowerInds.update(pos, valuesBuf);
+      } else {
+        upperInds.update(pos, valuesBuf);
+      }
+      // the heaps are still balanced but their tops may be out of order
+      if (valuesBuf[upperInds.top()] < valuesBuf[lowerInds.top()]) {
+        auto lower = lowerInds.pop(valuesBuf);
+        auto upper = upperInds.pop(valuesBuf);
+        lowerInds.push(upper, valuesBuf);
+        upperInds.push(lower, valuesBuf);
       }
-      // put the new value in the valuesBuffer
+    } else {
       valuesBuf.write(in);
-      // add the reference to the new value
-      if (in < old_med) {
-        lowerInds.insert(pos);
+      if (lowerInds.empty() || !(valuesBuf[lowerInds.top()] < in)) {
+        lowerInds.push(pos, valuesBuf);
       } else {
-        upperInds.insert(pos);
+        upperInds.push(pos, valuesBuf);
       }
-      // ensure the number of elements in the upperInds and the lowerInds sets
-      // do not differ by more than 1 
       rebalance();
     }
     return value();
@@ -187,29 +274,24 @@ class RollingMedian
   void print_state()
   {
     std::cout << "Lower: ";
-    impl::print_map<IndexSet, CircularBuffer>(lowerInds, valuesBuf);
+    impl::print_map<LowerHeap, CircularBuffer>(lowerInds, valuesBuf);
     std::cout << "Upper: ";
-    impl::print_map<IndexSet, CircularBuffer>(upperInds, valuesBuf);
+    impl::print_map<UpperHeap, CircularBuffer>(upperInds, valuesBuf);
     std::cout << "Value = " <<  value() << std::endl;
     std::cout << "Pos = " << valuesBuf.pos() << std::endl << std::endl;
   }
 
  private:
 
-  // Rebalance if the number of elements in the the upperInds
-  // and the lowerInds sets differs by more than one
+  // Rebalance so that lowerInds has the same number of elements as
+  // upperInds or one element more
   void rebalance()
   {
-    int k = upperInds.size() - lowerInds.size();
-    if (k > 1) {
-      auto ix = upperInds.first();
-      upperInds.remove_first(ix);
-      lowerInds.insert(ix);
+    if (lowerInds.size() > upperInds.size() + 1) {
+      upperInds.push(lowerInds.pop(valuesBuf), valuesBuf);
     }
-    else if (k < -1) {
-      auto ix = lowerInds.last();
-      lowerInds.remove_first(ix);
-      upperInds.insert(ix);
+    else if (upperInds.size() > lowerInds.size()) {
+      lowerInds.push(upperInds.pop(valuesBuf), valuesBuf);
     }
   }
 };
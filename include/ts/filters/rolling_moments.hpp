@@ -0,0 +1,331 @@
+// rolling_moments.hpp - rolling variance, covariance and correlation
+
+#ifndef ROLLING_MOMENTS_HPP
+#define ROLLING_MOMENTS_HPP
+
+#include <cmath>
+#include <utility>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/filters/circular_buffer.hpp>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// The mean and the sum of squared deviations from the mean of a window.
+///
+/// Observations are added, removed or replaced with Welford's updates which
+/// avoid the cancellation of the naive sums of squares. See, for instance,
+/// equation (44) in
+///
+/// Finch, T. (2009). "Incremental calculation of weighted mean and variance".
+/// University of Cambridge.
+///
+/// and its reverse for the removal.
+struct WindowMoments
+{
+  size_t n = 0;  ///< number of observations
+  double m = 0;  ///< the mean
+  double M2 = 0; ///< sum of squared distances from the mean
+
+  /// Adds an observation
+  void add(double x)
+  {
+    ++n;
+    auto delta = x - m;
+    m += delta / n;
+    M2 += delta * (x - m);
+  }
+
+  /// Removes an observation (which must be in the window)
+  void remove(double x)
+  {
+    if (n == 1) { *this = WindowMoments(); return; }
+    auto delta = x - m;
+    m -= delta / (n - 1);
+    M2 -= delta * (x - m);
+    --n;
+  }
+
+  /// Replaces the observation out with the observation in
+  void replace(double in, double out)
+  {
+    auto m0 = m;
+    m += (in - out) / n;
+    M2 += (in - m) * (in - m0) - (out - m) * (out - m0);
+  }
+
+  /// Recomputes the moments from the window with a two-pass algorithm
+  template<class Window>
+  void recompute(const Window& w, size_t count)
+  {
+    n = count;
+    double s = 0;
+    for (size_t i=0; i < count; ++i) s += w[i];
+    m = s / count;
+    M2 = 0;
+    for (size_t i=0; i < count; ++i) M2 += (w[i] - m) * (w[i] - m);
+  }
+};
+
+
+/// The means and the sums of squared deviations and of the cross products
+/// of deviations from the means of a window of pairs. The two-dimensional
+/// version of WindowMoments.
+struct WindowComoments
+{
+  size_t n = 0;   ///< number of observations
+  double mx = 0;  ///< the mean of the first input
+  double my = 0;  ///< the mean of the second input
+  double Cxx = 0; ///< n times the variance of the first input
+  double Cyy = 0; ///< n times the variance of the second input
+  double Cxy = 0; ///< n times the covariance
+
+  /// Adds an observation
+  void add(double x, double y)
+  {
+    ++n;
+    auto dx = x - mx;
+    auto dy = y - my;
+    mx += dx / n;
+    my += dy / n;
+    Cxx += dx * (x - mx);
+    Cyy += dy * (y - my);
+    Cxy += dx * (y - my);
+  }
+
+  /// Removes an observation (which must be in the window)
+  void remove(double x, double y)
+  {
+    if (n == 1) { *this = WindowComoments(); return; }
+    auto dx = x - mx;
+    auto dy = y - my;
+    mx -= dx / (n - 1);
+    my -= dy / (n - 1);
+    Cxx -= dx * (x - mx);
+    Cyy -= dy * (y - my);
+    Cxy -= (x - mx) * dy;
+    --n;
+  }
+
+  /// Replaces the observation (xout, yout) with (xin, yin)
+  void replace(double xin, double yin, double xout, double yout)
+  {
+    auto mx0 = mx, my0 = my;
+    mx += (xin - xout) / n;
+    my += (yin - yout) / n;
+    Cxx += (xin - mx) * (xin - mx0) - (xout - mx) * (xout - mx0);
+    Cyy += (yin - my) * (yin - my0) - (yout - my) * (yout - my0);
+    Cxy += (xin - mx) * (yin - my0) - (xout - mx) * (yout - my0);
+  }
+
+  /// Recomputes the moments from a window of pairs with a two-pass
+  /// algorithm
+  template<class Window>
+  void recompute(const Window& w, size_t count)
+  {
+    n = count;
+    double sx = 0, sy = 0;
+    for (size_t i=0; i < count; ++i) {
+      sx += w[i].first;
+      sy += w[i].second;
+    }
+    mx = sx / count;
+    my = sy / count;
+    Cxx = Cyy = Cxy = 0;
+    for (size_t i=0; i < count; ++i) {
+      auto dx = w[i].first - mx;
+      auto dy = w[i].second - my;
+      Cxx += dx * dx;
+      Cyy += dy * dy;
+      Cxy += dx * dy;
+    }
+  }
+};
+
+} // namespace impl
+
+
+/// Rolling (unbiased) variance with O(1) updates.
+///
+/// Once the window is full each observation replaces the oldest one by a
+/// Welford-style update. The rounding errors of the updates would slowly
+/// accumulate so the moments are recomputed from the window after every
+/// window_size updates, which keeps the amortized cost O(1).
+///
+/// The filter is considered to be ready to provide an ouput only when
+/// the window_size observations has been processed.
+class RollingVar
+{
+ public:
+  typedef double input_type;
+  typedef double output_type;
+
+  /// Constructs the filter with a given window size
+  RollingVar(size_t window_size)
+    : buf_(window_size),
+      since_recompute_(0)
+  {
+    if (window_size < 2)
+      throw TsException("RollingVar(): window_size must be at least 2");
+  }
+
+  /// Are we ready to provide the output?
+  bool ready() const { return buf_.full(); }
+
+  /// Returns the current variance
+  double value() const
+  {
+    return ready() ? moments_.M2 / (moments_.n - 1) : na::na<double>();
+  }
+
+  /// The mean of the current window
+  double mean() const { return moments_.m; }
+
+  /// Puts the new observation in the window and returns the variance
+  double operator() (double in)
+  {
+    if (buf_.full()) {
+      moments_.replace(in, buf_.write(in));
+      if (++since_recompute_ >= buf_.size()) {
+        moments_.recompute(buf_, buf_.size());
+        since_recompute_ = 0;
+      }
+    } else {
+      buf_.write(in);
+      moments_.add(in);
+    }
+    return value();
+  }
+
+ private:
+  impl::CircularBuffer<double> buf_; ///< The window
+  impl::WindowMoments moments_;      ///< The moments of the window
+  size_t since_recompute_;           ///< Updates since the last recompute
+};
+
+
+/// Rolling standard deviation (the square root of RollingVar).
+class RollingStd: public RollingVar
+{
+ public:
+  using RollingVar::RollingVar;
+
+  /// Returns the current standard deviation
+  double value() const { return std::sqrt(RollingVar::value()); }
+
+  /// Puts the new observation in the window and returns the std
+  double operator() (double in)
+  {
+    RollingVar::operator()(in);
+    return value();
+  }
+};
+
+
+/// Rolling (unbiased) covariance of two inputs with O(1) updates.
+///
+/// The inputs are passed either as two values or as a pair. The updates
+/// and the periodic recomputation are the same as in RollingVar.
+///
+/// The filter is considered to be ready to provide an ouput only when
+/// the window_size observations has been processed.
+class RollingCov
+{
+ public:
+  typedef std::pair<double, double> input_type;
+  typedef double output_type;
+
+  /// Constructs the filter with a given window size
+  RollingCov(size_t window_size)
+    : buf_(window_size),
+      since_recompute_(0)
+  {
+    if (window_size < 2)
+      throw TsException("RollingCov(): window_size must be at least 2");
+  }
+
+  /// Are we ready to provide the output?
+  bool ready() const { return buf_.full(); }
+
+  /// Returns the current covariance
+  double value() const { return ready() ? cov() : na::na<double>(); }
+
+  /// Covariance of the current window. No readiness checks.
+  double cov() const { return moments_.Cxy / (moments_.n - 1); }
+
+  /// Variance of the first input in the current window. No readiness checks.
+  double var1() const { return moments_.Cxx / (moments_.n - 1); }
+
+  /// Variance of the second input in the current window. No readiness checks.
+  double var2() const { return moments_.Cyy / (moments_.n - 1); }
+
+  /// Correlation of the current window. No readiness checks.
+  double corr() const
+  {
+    return moments_.Cxy / std::sqrt(moments_.Cxx * moments_.Cyy);
+  }
+
+  /// Puts the new observations in the window and returns the covariance
+  double operator() (double x, double y)
+  {
+    if (buf_.full()) {
+      auto out = buf_.write(std::make_pair(x, y));
+      moments_.replace(x, y, out.first, out.second);
+      if (++since_recompute_ >= buf_.size()) {
+        moments_.recompute(buf_, buf_.size());
+        since_recompute_ = 0;
+      }
+    } else {
+      buf_.write(std::make_pair(x, y));
+      moments_.add(x, y);
+    }
+    return value();
+  }
+
+  /// Puts the new observations in the window and returns the covariance
+  double operator() (const input_type& in)
+  {
+    return operator()(in.first, in.second);
+  }
+
+ private:
+  impl::CircularBuffer<input_type> buf_; ///< The window
+  impl::WindowComoments moments_;        ///< The moments of the window
+  size_t since_recompute_;               ///< Updates since the last recompute
+};
+
+
+/// Rolling correlation of two inputs (see RollingCov).
+class RollingCorr: public RollingCov
+{
+ public:
+  using RollingCov::RollingCov;
+
+  /// Returns the current correlation
+  double value() const { return ready() ? corr() : na::na<double>(); }
+
+  /// Puts the new observations in the window and returns the correlation
+  double operator() (double x, double y)
+  {
+    RollingCov::operator()(x, y);
+    return value();
+  }
+
+  /// Puts the new observations in the window and returns the correlation
+  double operator() (const input_type& in)
+  {
+    return operator()(in.first, in.second);
+  }
+};
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* ROLLING_MOMENTS_HPP */
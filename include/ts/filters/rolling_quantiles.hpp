@@ -0,0 +1,173 @@
+// rolling_quantiles.hpp - rolling order statistics on one shared window
+
+#ifndef ROLLING_QUANTILES_HPP
+#define ROLLING_QUANTILES_HPP
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/filters/circular_buffer.hpp>
+#include <ts/filters/skiplist.hpp>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// The k-th smallest element (counting from zero) of the union of two sorted
+/// sequences given by the accessors a(i), i < na and b(j), j < nb.
+///
+/// Uses a binary search on the number of elements taken from the first
+/// sequence so it needs O(log(na + nb)) calls of the accessors.
+template<typename T, class A, class B>
+T kth_of_two_sorted(const A& a, size_t na, const B& b, size_t nb, size_t k)
+{
+  size_t lo = k + 1 > nb ? k + 1 - nb : 0;
+  size_t hi = k + 1 < na ? k + 1 : na;
+  while (lo < hi) {
+    auto i = (lo + hi) / 2;
+    auto j = k + 1 - i;
+    if (a(i) < b(j - 1)) {
+      lo = i + 1;
+    } else {
+      hi = i;
+    }
+  }
+  auto i = lo, j = k + 1 - lo;
+  if (i == 0) return b(j - 1);
+  if (j == 0) return a(i - 1);
+  return a(i - 1) < b(j - 1) ? b(j - 1) : a(i - 1);
+}
+
+} // namespace impl
+
+
+/// Rolling order statistics (quantiles, minimum, maximum, median absolute
+/// deviation) sharing one window.
+///
+/// The values of the current window are kept sorted in an indexable
+/// skiplist and the circular buffer holds the handles of the skiplist nodes
+/// in the order of arrival, so each update removes the oldest node and
+/// inserts the new one in O(log window_size). Any order statistic is then
+/// available in O(log window_size) and the median absolute deviation in
+/// O(log^2 window_size), so computing several of them costs only one window.
+///
+/// The quantiles are interpolated linearly between the closest ranks, i.e.
+/// the p-quantile is x[h] + (h - floor(h)) (x[h+1] - x[h]) with
+/// h = (window_size - 1) p, which gives the usual median for p = 0.5.
+///
+/// The output of the filter are the quantiles given in the constructor.
+/// As the other rolling filters it is ready only when the window_size
+/// observations has been processed.
+template<typename T=double>
+class RollingQuantiles
+{
+ public:
+  typedef T input_type;
+  typedef std::vector<T> output_type;
+
+ private:
+
+  impl::CircularBuffer<size_t> handles_; ///< Skiplist handles in the window
+  impl::IndexableSkiplist<T> sorted_;    ///< The sorted values of the window
+  std::vector<double> probs_;            ///< The quantiles to output
+
+ public:
+
+  /// Constructs the filter with a given window size and the probabilities
+  /// of the quantiles which make its output
+  RollingQuantiles(size_t window_size, std::vector<double> probs)
+    : handles_(window_size),
+      probs_(std::move(probs))
+  {
+    if (window_size < 1)
+      throw TsException(
+          "RollingQuantiles(): window_size must be at least 1"
+      );
+    for (auto p: probs_) {
+      if (!(p >= 0 && p <= 1))
+        throw TsException(
+            "RollingQuantiles(): probabilities must be in [0, 1]"
+        );
+    }
+    sorted_.reserve(window_size);
+  }
+
+  /// Is the buffer already full?
+  bool ready() const { return handles_.full(); }
+
+  /// Returns the quantiles given in the constructor. Before the filter is
+  /// ready they are NA (or T() for the types without NA).
+  output_type value() const
+  {
+    if (!ready()) {
+      return output_type(probs_.size(), na::na_or_default<T>());
+    }
+    output_type res(probs_.size());
+    for (size_t i=0; i < probs_.size(); ++i) {
+      res[i] = quantile(probs_[i]);
+    }
+    return res;
+  }
+
+  /// The p-quantile of the current window. No readiness checks.
+  T quantile(double p) const
+  {
+    auto h = (sorted_.size() - 1) * p;
+    auto k = static_cast<size_t>(std::floor(h));
+    auto lower = sorted_.kth(k);
+    if (k + 1 >= sorted_.size() || h == k) return lower;
+    return lower + (h - k) * (sorted_.kth(k + 1) - lower);
+  }
+
+  /// The median of the current window. No readiness checks.
+  T median() const { return quantile(0.5); }
+
+  /// The minimum of the current window. No readiness checks.
+  T min() const { return sorted_.kth(0); }
+
+  /// The maximum of the current window. No readiness checks.
+  T max() const { return sorted_.kth(sorted_.size() - 1); }
+
+  /// The median absolute deviation from the median of the current window.
+  /// No readiness checks.
+  ///
+  /// The deviations of the values below and above the median make two
+  /// sorted sequences so their median is found by a binary search instead
+  /// of sorting the deviations.
+  T mad() const
+  {
+    const size_t n = sorted_.size();
+    const T med = median();
+    const size_t nlow = n - n / 2; // the values x[0], ..., x[nlow-1] <= med
+    auto below = [&](size_t i) -> T { return med - sorted_.kth(nlow - 1 - i); };
+    auto above = [&](size_t j) -> T { return sorted_.kth(nlow + j) - med; };
+    auto lower = impl::kth_of_two_sorted<T>(below, nlow, above, n - nlow,
+                                            (n - 1) / 2);
+    if (n % 2 == 1) return lower;
+    auto upper = impl::kth_of_two_sorted<T>(below, nlow, above, n - nlow,
+                                            n / 2);
+    return (lower + upper) / 2.0;
+  }
+
+  /// Puts the new observation in the window and returns the quantiles
+  output_type operator() (T in)
+  {
+    if (handles_.full()) {
+      sorted_.erase(handles_[handles_.pos()]);
+    }
+    handles_.write(sorted_.insert(in));
+    return value();
+  }
+};
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* ROLLING_QUANTILES_HPP */
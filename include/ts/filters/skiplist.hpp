@@ -0,0 +1,230 @@
+// skiplist.hpp - indexable skiplist used for rolling order statistics
+
+#ifndef SKIPLIST_HPP
+#define SKIPLIST_HPP
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+
+namespace ts {
+
+namespace filters {
+
+namespace impl {
+
+/// A sorted sequence supporting insertion, removal and access by rank, all
+/// in O(log n) expected time.
+///
+/// Every link of the skiplist stores its width, i.e. the number of positions
+/// it skips, which gives the access by rank (see R. Hettinger's "Efficient
+/// Running Median using an Indexable Skiplist"). Elements are referred to by
+/// handles returned from insert(). Ties between equal values are broken by
+/// the handles so that the removal finds the exact element without scanning
+/// through duplicates.
+///
+/// Nodes are kept in a pool and reused after erase(); the level of a node is
+/// drawn once when the node is created. A sequence which does not grow beyond
+/// its largest size thus allocates no memory.
+template<typename T, class Compare=std::less<T> >
+class IndexableSkiplist
+{
+ public:
+
+  /// Maximal number of levels.
+  static constexpr size_t max_level = 32;
+
+  /// Constructs an empty skiplist.
+  IndexableSkiplist(const Compare& comp=Compare())
+    : comp_(comp),
+      top_(0),
+      size_(0),
+      rng_(0x9E3779B97F4A7C15ull)
+  {
+    // the head node is the node 0 with all the levels
+    values_.push_back(T());
+    level_.push_back(max_level);
+    offset_.push_back(0);
+    links_.resize(max_level, Link{nil, 0});
+  }
+
+  /// Number of elements
+  size_t size() const { return size_; }
+
+  /// Is the skiplist empty?
+  bool empty() const { return size_ == 0; }
+
+  /// Preallocates the memory for n elements.
+  void reserve(size_t n)
+  {
+    values_.reserve(n + 1);
+    level_.reserve(n + 1);
+    offset_.reserve(n + 1);
+    links_.reserve(max_level + 2 * n);
+    free_.reserve(n);
+  }
+
+  /// The value referred to by a handle.
+  const T& value(size_t handle) const { return values_[handle]; }
+
+  /// The k-th smallest element (counting from zero). No checks.
+  const T& kth(size_t k) const
+  {
+    size_t x = head, pos = 0, target = k + 1;
+    for (size_t l = top_; l-- > 0; ) {
+      while (next(x, l) != nil && pos + width(x, l) <= target) {
+        pos += width(x, l);
+        x = next(x, l);
+      }
+    }
+    return values_[x];
+  }
+
+  /// Inserts a value and returns its handle.
+  size_t insert(T val)
+  {
+    auto node = allocate(val);
+    auto d = level_[node];
+    for (size_t l = top_; l < d; ++l) {
+      links_[l] = Link{nil, 0};
+    }
+    if (d > top_) top_ = d;
+
+    size_t chain[max_level];
+    size_t chainPos[max_level];
+    size_t x = head, pos = 0;
+    for (size_t l = top_; l-- > 0; ) {
+      while (next(x, l) != nil && less(next(x, l), node)) {
+        pos += width(x, l);
+        x = next(x, l);
+      }
+      chain[l] = x;
+      chainPos[l] = pos;
+    }
+    // the new node is at the position pos + 1
+    for (size_t l = 0; l < d; ++l) {
+      link(node, l) = Link{
+        next(chain[l], l),
+        chainPos[l] + width(chain[l], l) - pos
+      };
+      link(chain[l], l) = Link{node, pos + 1 - chainPos[l]};
+    }
+    for (size_t l = d; l < top_; ++l) {
+      ++link(chain[l], l).width;
+    }
+    ++size_;
+    return node;
+  }
+
+  /// Removes the element referred to by the handle.
+  void erase(size_t node)
+  {
+    size_t x = head;
+    for (size_t l = top_; l-- > 0; ) {
+      while (next(x, l) != nil && less(next(x, l), node)) {
+        x = next(x, l);
+      }
+      if (l < level_[node]) {
+        // x precedes the node on this level
+        link(x, l).next = next(node, l);
+        link(x, l).width += width(node, l) - 1;
+      } else {
+        --link(x, l).width;
+      }
+    }
+    free_.push_back(node);
+    --size_;
+  }
+
+ private:
+
+  /// Marks the end of a list.
+  static constexpr size_t nil = std::numeric_limits<size_t>::max();
+
+  /// The handle of the head node.
+  static constexpr size_t head = 0;
+
+  /// A link to the next node on a given level. The width of the links
+  /// pointing to nil is not maintained.
+  struct Link
+  {
+    size_t next;
+    size_t width;
+  };
+
+  Compare comp_;                ///< Comparison of the values
+  size_t top_;                  ///< Number of levels in use
+  size_t size_;                 ///< Number of elements
+  uint64_t rng_;                ///< State of the level generator
+  std::vector<T> values_;       ///< The values of the nodes
+  std::vector<size_t> level_;   ///< The number of levels of each node
+  std::vector<size_t> offset_;  ///< Position of a node's links in links_
+  std::vector<Link> links_;     ///< The links of all the nodes
+  std::vector<size_t> free_;    ///< The nodes available for reuse
+
+  Link& link(size_t node, size_t l) { return links_[offset_[node] + l]; }
+  size_t next(size_t node, size_t l) const
+  {
+    return links_[offset_[node] + l].next;
+  }
+  size_t width(size_t node, size_t l) const
+  {
+    return links_[offset_[node] + l].width;
+  }
+
+  /// Orders the nodes by their values and then by their handles.
+  bool less(size_t a, size_t b) const
+  {
+    if (comp_(values_[a], values_[b])) return true;
+    if (comp_(values_[b], values_[a])) return false;
+    return a < b;
+  }
+
+  /// Draws the number of levels of a new node (geometric with p = 1/2).
+  size_t random_level()
+  {
+    // xorshift64
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 7;
+    rng_ ^= rng_ << 17;
+    size_t d = 1;
+    for (auto bits = rng_; (bits & 1) && d < max_level; bits >>= 1) ++d;
+    return d;
+  }
+
+  /// Takes a node from the pool or creates a new one.
+  size_t allocate(T val)
+  {
+    if (!free_.empty()) {
+      auto node = free_.back();
+      free_.pop_back();
+      values_[node] = val;
+      return node;
+    }
+    auto d = random_level();
+    values_.push_back(val);
+    level_.push_back(d);
+    offset_.push_back(links_.size());
+    links_.resize(links_.size() + d, Link{nil, 0});
+    return values_.size() - 1;
+  }
+};
+
+template<typename T, class Compare>
+constexpr size_t IndexableSkiplist<T, Compare>::max_level;
+
+template<typename T, class Compare>
+constexpr size_t IndexableSkiplist<T, Compare>::nil;
+
+template<typename T, class Compare>
+constexpr size_t IndexableSkiplist<T, Compare>::head;
+
+} // namespace impl
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* SKIPLIST_HPP */
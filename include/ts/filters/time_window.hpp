@@ -0,0 +1,249 @@
+// time_window.hpp - rolling filters over windows of a fixed duration
+
+#ifndef TIME_WINDOW_HPP
+#define TIME_WINDOW_HPP
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/filters/circular_buffer.hpp>
+#include <ts/filters/compensated_sum.hpp>
+#include <ts/filters/rolling_moments.hpp>
+#include <ts/filters/skiplist.hpp>
+
+
+namespace ts {
+
+namespace filters {
+
+/// Simple moving average over the observations of the last window_length
+/// time units.
+///
+/// The filter is fed (timestamp, value) pairs with non-decreasing timestamps
+/// and the window at time t covers the timestamps in (t - window_length, t].
+/// The observations are kept in a ring which grows only when the window
+/// holds more observations than ever before, so the memory follows the
+/// busiest window. The sum of the window is compensated for the rounding
+/// errors as in RollingMean.
+///
+/// The filter is considered to be ready to provide an ouput once the
+/// observations span at least window_length, i.e. the window is covered by
+/// the history.
+template<typename Timestamp, typename Duration=Timestamp>
+class TimeRollingMean
+{
+ public:
+  typedef double input_type;
+  typedef double output_type;
+
+  /// Constructs the filter with a given window length
+  TimeRollingMean(Duration window_length)
+    : window_(window_length),
+      ready_(false),
+      first_()
+  {}
+
+  /// Returns the current value of the mean
+  double value() const
+  {
+    return ready() ? sum_.value() / buf_.size() : na::na<double>();
+  }
+
+  /// Are we ready to provide the output?
+  bool ready() const { return ready_; }
+
+  /// Number of observations in the current window
+  size_t count() const { return buf_.size(); }
+
+  /// Puts the new observation in the window and returns the mean
+  double operator() (Timestamp t, double valIn)
+  {
+    if (buf_.empty()) first_ = t; // the first observation ever
+    ready_ = ready_ || !(t < first_ + window_);
+    while (!buf_.empty() && !(t < buf_.front().first + window_)) {
+      sum_ -= buf_.front().second;
+      buf_.pop_front();
+    }
+    buf_.push_back(std::make_pair(t, valIn));
+    sum_ += valIn;
+    return value();
+  }
+
+ private:
+  Duration window_;   ///< The window length
+  impl::CompensatedSum sum_; ///< Sum of the values in the window
+  bool ready_;        ///< Does the history cover the window?
+  Timestamp first_;   ///< The first timestamp ever seen
+  impl::RingDeque<std::pair<Timestamp, double> > buf_; ///< The window
+};
+
+
+/// Rolling median over the observations of the last window_length time
+/// units.
+///
+/// The filter is fed (timestamp, value) pairs with non-decreasing timestamps
+/// and the window at time t covers the timestamps in (t - window_length, t].
+/// The values of the window are kept sorted in an indexable skiplist whose
+/// handles are stored in a ring in the order of arrival. Both grow only when
+/// the window holds more observations than ever before. An update costs
+/// O(log n) per observation entering or leaving the window.
+///
+/// The filter is considered to be ready to provide an ouput once the
+/// observations span at least window_length, i.e. the window is covered by
+/// the history. The median of an even number of integral values may be a
+/// half so the output is a double for the integral types.
+template<typename Timestamp, typename T=double, typename Duration=Timestamp>
+class TimeRollingMedian
+{
+ public:
+  typedef T input_type;
+  typedef typename std::conditional<
+    std::is_integral<T>::value, double, T
+  >::type output_type;
+
+  /// Constructs the filter with a given window length
+  TimeRollingMedian(Duration window_length)
+    : window_(window_length),
+      ready_(false),
+      first_()
+  {}
+
+  /// Are we ready to provide the output?
+  bool ready() const { return ready_; }
+
+  /// Number of observations in the current window
+  size_t count() const { return buf_.size(); }
+
+  /// Returns the current median, NA (or T() for the types without NA)
+  /// before the filter is ready
+  output_type value() const
+  {
+    if (!ready()) return na::na_or_default<output_type>();
+    auto n = sorted_.size();
+    return (output_type(sorted_.kth((n - 1) / 2)) + sorted_.kth(n / 2)) / 2;
+  }
+
+  /// Puts the new observation in the window and returns the median
+  output_type operator() (Timestamp t, T in)
+  {
+    if (buf_.empty()) first_ = t; // the first observation ever
+    ready_ = ready_ || !(t < first_ + window_);
+    while (!buf_.empty() && !(t < buf_.front().first + window_)) {
+      sorted_.erase(buf_.front().second);
+      buf_.pop_front();
+    }
+    buf_.push_back(std::make_pair(t, sorted_.insert(in)));
+    return value();
+  }
+
+ private:
+  Duration window_;   ///< The window length
+  bool ready_;        ///< Does the history cover the window?
+  Timestamp first_;   ///< The first timestamp ever seen
+  impl::RingDeque<std::pair<Timestamp, size_t> > buf_; ///< Handles by arrival
+  impl::IndexableSkiplist<T> sorted_; ///< The sorted values of the window
+};
+
+
+/// Rolling (unbiased) covariance of two inputs over the observations of the
+/// last window_length time units.
+///
+/// The filter is fed (timestamp, x, y) or (timestamp, (x, y)) with
+/// non-decreasing timestamps and the window at time t covers the timestamps
+/// in (t - window_length, t]. The moments of the window are updated as the
+/// observations enter and leave it like in RollingCov and recomputed from
+/// the window once as many observations have left it as it holds. Besides
+/// the covariance it provides the correlation and the beta (the slope of
+/// the regression of y on x).
+///
+/// The filter is considered to be ready to provide an ouput once the
+/// observations span at least window_length, i.e. the window is covered by
+/// the history.
+template<typename Timestamp, typename Duration=Timestamp>
+class TimeRollingCov
+{
+ public:
+  typedef std::pair<double, double> input_type;
+  typedef double output_type;
+
+  /// Constructs the filter with a given window length
+  TimeRollingCov(Duration window_length)
+    : window_(window_length),
+      ready_(false),
+      first_(),
+      since_recompute_(0)
+  {}
+
+  /// Are we ready to provide the output?
+  bool ready() const { return ready_; }
+
+  /// Number of observations in the current window
+  size_t count() const { return buf_.size(); }
+
+  /// Returns the current covariance
+  double value() const { return ready() ? cov() : na::na<double>(); }
+
+  /// Covariance of the current window. No readiness checks.
+  double cov() const { return moments_.Cxy / (moments_.n - 1); }
+
+  /// Variance of x in the current window. No readiness checks.
+  double var1() const { return moments_.Cxx / (moments_.n - 1); }
+
+  /// Variance of y in the current window. No readiness checks.
+  double var2() const { return moments_.Cyy / (moments_.n - 1); }
+
+  /// Correlation of the current window. No readiness checks.
+  double corr() const
+  {
+    return moments_.Cxy / std::sqrt(moments_.Cxx * moments_.Cyy);
+  }
+
+  /// The regression coefficient of y on x in the current window. No
+  /// readiness checks.
+  double beta() const { return moments_.Cxy / moments_.Cxx; }
+
+  /// Puts the new observations in the window and returns the covariance
+  double operator() (Timestamp t, double x, double y)
+  {
+    if (buf_.empty()) first_ = t; // the first observation ever
+    ready_ = ready_ || !(t < first_ + window_);
+    while (!buf_.empty() && !(t < times_.front() + window_)) {
+      moments_.remove(buf_.front().first, buf_.front().second);
+      buf_.pop_front();
+      times_.pop_front();
+      ++since_recompute_;
+    }
+    times_.push_back(t);
+    buf_.push_back(std::make_pair(x, y));
+    moments_.add(x, y);
+    if (since_recompute_ >= buf_.size()) {
+      moments_.recompute(buf_, buf_.size());
+      since_recompute_ = 0;
+    }
+    return value();
+  }
+
+  /// Puts the new observations in the window and returns the covariance
+  double operator() (Timestamp t, const input_type& in)
+  {
+    return operator()(t, in.first, in.second);
+  }
+
+ private:
+  Duration window_;   ///< The window length
+  bool ready_;        ///< Does the history cover the window?
+  Timestamp first_;   ///< The first timestamp ever seen
+  size_t since_recompute_; ///< Removals since the last recompute
+  impl::RingDeque<Timestamp> times_;  ///< The timestamps of the window
+  impl::RingDeque<input_type> buf_;   ///< The observations of the window
+  impl::WindowComoments moments_;     ///< The moments of the window
+};
+
+} // namespace filters
+
+} // namespace ts
+
+#endif /* TIME_WINDOW_HPP */
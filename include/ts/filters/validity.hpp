@@ -15,7 +15,7 @@ class CountingFilter
  protected:
    
   /// Increment the counter
-  void inc() { ++n; } 
+  void inc(size_t k=1) { n += k; } 
 
  public:
 
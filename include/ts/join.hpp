@@ -0,0 +1,93 @@
+// join.hpp - as-of and inner joins of two series.
+
+#ifndef JOIN_HPP
+#define JOIN_HPP
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+/// As-of join: for each observation of x the last observation of y at or
+/// before its timestamp.
+///
+/// Returns two series with the timestamps of x: the values of x and the
+/// matching values of y. The observations of x preceding the first one of y
+/// have no match and are left out. The search in y gallops from the
+/// previous match, so a sparse x against a dense y costs O(log gap) per
+/// observation of x instead of a step per observation of y.
+template<typename Timestamp, typename Value1, typename Value2>
+std::pair<Series<Timestamp, Value1>, Series<Timestamp, Value2> >
+asof_join(const Series<Timestamp, Value1>& x,
+          const Series<Timestamp, Value2>& y)
+{
+  const auto& xi = x.indexView();
+  const auto& yi = y.indexView();
+  // the observations of x before the first one of y have no match
+  auto first = yi.empty() ? xi.size()
+    : impl::gallop_lower_bound(xi.begin(), xi.end(), yi.front()) - xi.begin();
+
+  std::vector<Timestamp> index;
+  std::vector<Value1> xvals;
+  std::vector<Value2> yvals;
+  index.reserve(xi.size() - first);
+  xvals.reserve(xi.size() - first);
+  yvals.reserve(xi.size() - first);
+  auto pos = yi.begin(); // the first timestamp of y after the previous match
+  for (size_t i=first; i < xi.size(); ++i) {
+    pos = impl::gallop_upper_bound(pos, yi.end(), xi[i]);
+    index.push_back(xi[i]);
+    xvals.push_back(x.valuesView()[i]);
+    yvals.push_back(y.valuesView()[pos - yi.begin() - 1]);
+  }
+  auto xres = Series<Timestamp, Value1>(index, std::move(xvals));
+  auto yres = Series<Timestamp, Value2>(std::move(index), std::move(yvals));
+  return std::make_pair(std::move(xres), std::move(yres));
+}
+
+
+/// Inner join: the observations of x and y at the timestamps present in
+/// both series.
+///
+/// Returns two series with the common timestamps: the values of x and the
+/// values of y. Repeated timestamps are matched one to one in order. The
+/// two series are walked alternately, each galloping to the current
+/// timestamp of the other one, so the cost follows the number of runs of
+/// non-matching timestamps rather than the sizes of the series.
+template<typename Timestamp, typename Value1, typename Value2>
+std::pair<Series<Timestamp, Value1>, Series<Timestamp, Value2> >
+inner_join(const Series<Timestamp, Value1>& x,
+           const Series<Timestamp, Value2>& y)
+{
+  const auto& xi = x.indexView();
+  const auto& yi = y.indexView();
+
+  std::vector<Timestamp> index;
+  std::vector<Value1> xvals;
+  std::vector<Value2> yvals;
+  auto cx = xi.begin(), cy = yi.begin();
+  while (cx != xi.end() && cy != yi.end()) {
+    if (*cx < *cy) {
+      cx = impl::gallop_lower_bound(cx, xi.end(), *cy);
+    } else if (*cy < *cx) {
+      cy = impl::gallop_lower_bound(cy, yi.end(), *cx);
+    } else {
+      index.push_back(*cx);
+      xvals.push_back(x.valuesView()[cx - xi.begin()]);
+      yvals.push_back(y.valuesView()[cy - yi.begin()]);
+      ++cx;
+      ++cy;
+    }
+  }
+  auto xres = Series<Timestamp, Value1>(index, std::move(xvals));
+  auto yres = Series<Timestamp, Value2>(std::move(index), std::move(yvals));
+  return std::make_pair(std::move(xres), std::move(yres));
+}
+
+} // namespace ts
+
+#endif /* JOIN_HPP */
@@ -0,0 +1,279 @@
+// mapped.hpp - memory-mapped columnar series files (POSIX only).
+
+#ifndef MAPPED_HPP
+#define MAPPED_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+namespace impl {
+
+/// The header of a columnar series file.
+///
+/// The file is the header followed by the index column, the values column
+/// and optionally a NA bitmap (bit i of byte i / 8 set when the value i is
+/// NA), each starting at a multiple of mapped_alignment. The numbers are
+/// stored in the native byte order of the machine writing the file.
+struct MappedHeader
+{
+  char magic[8];         ///< "TSCOLv1" and a zero byte
+  uint32_t index_size;   ///< sizeof(Timestamp)
+  uint32_t value_size;   ///< sizeof(Value)
+  uint64_t count;        ///< Number of observations
+  uint64_t index_offset; ///< Position of the index column
+  uint64_t values_offset; ///< Position of the values column
+  uint64_t na_offset;    ///< Position of the NA bitmap or 0 if absent
+  char reserved[16];     ///< Zeros
+};
+
+static_assert(sizeof(MappedHeader) == 64, "unexpected MappedHeader padding");
+
+/// The alignment of the columns in the file (a cache line)
+const uint64_t mapped_alignment = 64;
+
+/// The magic string identifying the files
+inline const char* mapped_magic() { return "TSCOLv1"; }
+
+/// Rounds n up to a multiple of mapped_alignment
+inline uint64_t mapped_align(uint64_t n)
+{
+  return (n + mapped_alignment - 1) / mapped_alignment * mapped_alignment;
+}
+
+} // namespace impl
+
+
+/// Writes the series to a columnar file which can be opened as MappedSeries.
+///
+/// The index and the values are written as raw arrays so both must be
+/// trivially copyable. With na_bitmap set the NA values (for the types
+/// having them) are also marked in a bitmap.
+template<typename Timestamp, typename Value>
+void write_mapped(const std::string& path,
+                  const Series<Timestamp, Value>& x,
+                  bool na_bitmap=false)
+{
+  static_assert(std::is_trivially_copyable<Timestamp>::value
+                && std::is_trivially_copyable<Value>::value,
+                "write_mapped(): the types must be trivially copyable");
+  const uint64_t n = x.size();
+  impl::MappedHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::strcpy(h.magic, impl::mapped_magic());
+  h.index_size = sizeof(Timestamp);
+  h.value_size = sizeof(Value);
+  h.count = n;
+  h.index_offset = impl::mapped_align(sizeof(h));
+  h.values_offset = impl::mapped_align(h.index_offset + n * sizeof(Timestamp));
+  uint64_t end = h.values_offset + n * sizeof(Value);
+  std::vector<unsigned char> bitmap;
+  if (na_bitmap) {
+    h.na_offset = impl::mapped_align(end);
+    bitmap.assign((n + 7) / 8, 0);
+    for (uint64_t i=0; i < n; ++i) {
+      if (na::can_na<Value>() && na::is_na<Value>(x.values_data()[i])) {
+        bitmap[i / 8] |= 1 << (i % 8);
+      }
+    }
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw IoError("write_mapped(): cannot open " + path);
+  const char zeros[impl::mapped_alignment] = {};
+  auto pad_to = [&](uint64_t pos) {
+    out.write(zeros, pos - static_cast<uint64_t>(out.tellp()));
+  };
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  pad_to(h.index_offset);
+  out.write(reinterpret_cast<const char*>(x.index_data()),
+            n * sizeof(Timestamp));
+  pad_to(h.values_offset);
+  out.write(reinterpret_cast<const char*>(x.values_data()),
+            n * sizeof(Value));
+  if (na_bitmap) {
+    pad_to(h.na_offset);
+    out.write(reinterpret_cast<const char*>(bitmap.data()), bitmap.size());
+  }
+  if (!out) throw IoError("write_mapped(): cannot write " + path);
+}
+
+
+/// A read-only series backed by a memory-mapped columnar file written by
+/// write_mapped().
+///
+/// Opening maps the file without reading it so it costs O(1) whatever the
+/// size; the pages are loaded on first access and shared through the page
+/// cache with the other processes mapping the same file. The series
+/// supports the same paired iteration, application of functors, moments,
+/// slicing and merging as the Series. The header is checked against the
+/// template parameters and an IoError is thrown on any mismatch.
+template<typename Timestamp, typename Value=double>
+class MappedSeries: public impl::SeriesBase<MappedSeries<Timestamp, Value>,
+                                            Timestamp, Value>
+{
+ public:
+
+  typedef MappedSeries<Timestamp, Value> this_type;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef impl::Span<Timestamp> index_type;
+  typedef impl::Span<Value> values_type;
+  typedef IndexValueIter<const Timestamp*, const Value*> paired_iterator_type;
+
+  /// Maps the file at path
+  explicit MappedSeries(const std::string& path)
+    : data_(nullptr),
+      length_(0),
+      na_(nullptr)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw IoError("MappedSeries: cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw IoError("MappedSeries: cannot stat " + path);
+    }
+    length_ = st.st_size;
+    if (length_ < sizeof(impl::MappedHeader)) {
+      ::close(fd);
+      throw IoError("MappedSeries: " + path + " is too short");
+    }
+    void* p = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) throw IoError("MappedSeries: cannot map " + path);
+    data_ = static_cast<const char*>(p);
+    try {
+      init(path);
+    } catch (...) {
+      ::munmap(const_cast<char*>(data_), length_);
+      throw;
+    }
+  }
+
+  MappedSeries(const this_type&) = delete;
+  this_type& operator=(const this_type&) = delete;
+
+  /// Takes the mapping of other leaving it empty
+  MappedSeries(this_type&& other)
+    : data_(other.data_),
+      length_(other.length_),
+      index_(other.index_),
+      values_(other.values_),
+      na_(other.na_)
+  {
+    other.reset();
+  }
+
+  /// Unmaps the file and takes the mapping of other leaving it empty
+  this_type& operator=(this_type&& other)
+  {
+    if (this == &other) return *this;
+    unmap();
+    data_ = other.data_;
+    length_ = other.length_;
+    index_ = other.index_;
+    values_ = other.values_;
+    na_ = other.na_;
+    other.reset();
+    return *this;
+  }
+
+  ~MappedSeries() { unmap(); }
+
+  /// Returns the length of the time series
+  size_t size() const { return index_.size(); }
+
+  /// Returns the read-only view of the index
+  const index_type& indexView() const { return index_; }
+
+  /// Returns the read-only view of the values
+  const values_type& valuesView() const { return values_; }
+
+  /// The index as a contiguous array
+  const Timestamp* index_data() const { return index_.data(); }
+
+  /// The values as a contiguous array
+  const Value* values_data() const { return values_.data(); }
+
+  /// Does the file have a NA bitmap?
+  bool has_na_bitmap() const { return na_ != nullptr; }
+
+  /// Is the value i marked as NA in the bitmap? False without the bitmap.
+  bool is_na(size_t i) const
+  {
+    return na_ && (na_[i / 8] >> (i % 8) & 1);
+  }
+
+ private:
+
+  /// Releases the mapping if any
+  void unmap()
+  {
+    if (data_) ::munmap(const_cast<char*>(data_), length_);
+  }
+
+  /// Leaves the series empty without a mapping
+  void reset()
+  {
+    data_ = nullptr;
+    length_ = 0;
+    index_ = index_type();
+    values_ = values_type();
+    na_ = nullptr;
+  }
+
+  /// Checks the header and sets up the columns
+  void init(const std::string& path)
+  {
+    impl::MappedHeader h;
+    std::memcpy(&h, data_, sizeof(h));
+    if (std::strncmp(h.magic, impl::mapped_magic(), sizeof(h.magic)) != 0)
+      throw IoError("MappedSeries: " + path + " is not a series file");
+    if (h.index_size != sizeof(Timestamp) || h.value_size != sizeof(Value))
+      throw IoError("MappedSeries: " + path + " has other types");
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+      return offset % impl::mapped_alignment == 0
+        && offset <= length_ && bytes <= length_ - offset;
+    };
+    if (h.count > length_
+        || !fits(h.index_offset, h.count * sizeof(Timestamp))
+        || !fits(h.values_offset, h.count * sizeof(Value))
+        || (h.na_offset && !fits(h.na_offset, (h.count + 7) / 8)))
+      throw IoError("MappedSeries: " + path + " is truncated or corrupt");
+    index_ = index_type(
+        reinterpret_cast<const Timestamp*>(data_ + h.index_offset), h.count
+    );
+    values_ = values_type(
+        reinterpret_cast<const Value*>(data_ + h.values_offset), h.count
+    );
+    if (h.na_offset) {
+      na_ = reinterpret_cast<const unsigned char*>(data_ + h.na_offset);
+    }
+  }
+
+  const char* data_;    ///< The mapped file
+  size_t length_;       ///< The length of the mapping
+  index_type index_;    ///< The index column
+  values_type values_;  ///< The values column
+  const unsigned char* na_; ///< The NA bitmap or nullptr
+};
+
+} // namespace ts
+
+#endif /* MAPPED_HPP */
@@ -3,6 +3,7 @@
 #ifndef MERGE_HPP
 #define MERGE_HPP 
 
+#include <algorithm>
 #include <vector>
 #include <initializer_list>
 #include <iostream>
@@ -14,6 +15,11 @@ namespace ts {
 
 
 /// Merges series on their timestamps. Not an iterator in strict C++ sense.
+///
+/// The series which are not exhausted are kept in a binary min-heap ordered
+/// by their current timestamp and, on ties, by the series index, so a step
+/// costs O(log N) for N series and the observations with equal timestamps
+/// come in the order of the series.
 template<typename Series>
 class MergeIterator
 {
@@ -22,16 +28,49 @@ class MergeIterator
 
   std::vector<itr_type> itrs_; // current iterators for each series
   std::vector<itr_type> ends_; // end iteratators for each series
+  std::vector<size_t> heap_; // indices of the series left, min-heap
   int cur_; // index of the current series or -1
 
-  // set cur to the index of the iterator with the minimum timestamp.
-  void set_current()
+  // does the series i come before the series j?
+  bool before(size_t i, size_t j) const
+  {
+    if (itrs_[i].index() < itrs_[j].index()) return true;
+    if (itrs_[j].index() < itrs_[i].index()) return false;
+    return i < j;
+  }
+
+  // restore the heap property after the top has changed
+  void sift_down()
+  {
+    const size_t n = heap_.size();
+    const size_t top = heap_[0];
+    size_t pos = 0;
+    for (;;) {
+      size_t child = 2 * pos + 1;
+      if (child >= n) break;
+      if (child + 1 < n && before(heap_[child + 1], heap_[child])) ++child;
+      if (!before(heap_[child], top)) break;
+      heap_[pos] = heap_[child];
+      pos = child;
+    }
+    heap_[pos] = top;
+  }
+
+  // build the heap of the non-empty series
+  void make_heap()
   {
-    cur_ = -1;
     for (size_t i=0; i < itrs_.size(); ++i) {
-      if (itrs_[i] == ends_[i]) continue;
-      if (-1 == cur_ || itrs_[i].index() < itrs_[cur_].index()) cur_ = i;
+      if (!(itrs_[i] == ends_[i])) heap_.push_back(i);
     }
+    std::make_heap(heap_.begin(), heap_.end(),
+                   [this](size_t i, size_t j) { return before(j, i); });
+    set_current();
+  }
+
+  // set cur to the index of the iterator with the minimum timestamp.
+  void set_current()
+  {
+    cur_ = heap_.empty() ? -1 : heap_[0];
   }
 
  public:
@@ -41,7 +80,7 @@ class MergeIterator
     : itrs_(std::forward< std::vector<itr_type> >(itrs)),
       ends_(std::forward< std::vector<itr_type> >(ends))
   {
-    set_current();
+    make_heap();
   }
 
   /// Creates a merge iterator from a collection of pointers to Series.
@@ -70,6 +109,11 @@ class MergeIterator
   void operator++ ()
   {
     itrs_[cur_] = ++itrs_[cur_];
+    if (itrs_[cur_] == ends_[cur_]) {
+      heap_[0] = heap_.back();
+      heap_.pop_back();
+    }
+    if (!heap_.empty()) sift_down();
     set_current();
   }
 
@@ -84,7 +128,97 @@ class MergeIterator
 };
 
 
+/// Merges series on their timestamps one distinct timestamp at a time.
+///
+/// At each step the cursor exposes the timestamp and a dense row with one
+/// slot per series: values()[i] holds the value of the series i and
+/// present(i) tells whether the series has an observation at the timestamp
+/// (an outer join of the series). The row is reused between the steps and
+/// only the slots filled at the previous step are cleared, so a step costs
+/// O(k log N) for k observations at the timestamp and does not allocate.
+/// The values of the absent series are unspecified. If a series has several
+/// observations at the same timestamp the last one is kept.
+template<typename Series>
+class AlignedMergeIterator
+{
+  using timestamp_type = typename Series::timestamp_type;
+  using value_type = typename Series::value_type;
+
+  MergeIterator<Series> merge_; // the observations one by one
+  std::vector<value_type> values_; // the current row
+  std::vector<char> present_; // is values_[i] set at the current timestamp?
+  std::vector<size_t> filled_; // the series present, in order of arrival
+  timestamp_type timestamp_; // the current timestamp
+  bool at_end_; // no more timestamps?
 
+  // collect the observations at the next timestamp
+  void next_row()
+  {
+    for (auto i: filled_) present_[i] = 0;
+    filled_.clear();
+    at_end_ = merge_.at_end();
+    if (at_end_) return;
+    timestamp_ = merge_.timestamp();
+    while (merge_ && !(timestamp_ < merge_.timestamp())) {
+      size_t i = merge_.series();
+      if (!present_[i]) {
+        present_[i] = 1;
+        filled_.push_back(i);
+      }
+      values_[i] = merge_.value();
+      ++merge_;
+    }
+  }
+
+ public:
+
+  AlignedMergeIterator(MergeIterator<Series> merge)
+    : merge_(std::move(merge)),
+      values_(merge_.n_series()),
+      present_(merge_.n_series(), 0),
+      timestamp_(),
+      at_end_(false)
+  {
+    filled_.reserve(merge_.n_series());
+    next_row();
+  }
+
+  /// Creates an aligned merge iterator from a collection of pointers to
+  /// Series.
+  template<class SeriesPtrs>
+  static AlignedMergeIterator from_series_ptrs(const SeriesPtrs& ptrs)
+  {
+    return AlignedMergeIterator(MergeIterator<Series>::from_series_ptrs(ptrs));
+  }
+
+  /// Current timestamp.
+  timestamp_type timestamp() const { return timestamp_; }
+
+  /// Values of the series at the current timestamp (valid where present).
+  const std::vector<value_type>& values() const { return values_; }
+
+  /// Does the series i have an observation at the current timestamp?
+  bool present(size_t i) const { return present_[i] != 0; }
+
+  /// The presence flags of all the series at the current timestamp.
+  const std::vector<char>& present_mask() const { return present_; }
+
+  /// Indices of the series present at the current timestamp in the order
+  /// their first observations were merged.
+  const std::vector<size_t>& present_series() const { return filled_; }
+
+  /// Move to the next timestamp.
+  void operator++ () { next_row(); }
+
+  /// Are there timestamps left?
+  bool at_end() const { return at_end_; }
+
+  /// Conversion to bool for easy while loops.
+  operator bool() const { return !at_end(); }
+
+  /// Number of input series.
+  size_t n_series() const { return values_.size(); }
+};
 
 
 template<typename Series>
@@ -102,6 +236,11 @@ class SeriesCollection: public std::vector<const Series*>
     return MergeIterator<Series>(get_begins(), get_ends());
   }
 
+  auto aligned_merge_iterator() const -> decltype(auto)
+  {
+    return AlignedMergeIterator<Series>(merge_iterator());
+  }
+
  private:
 
   auto get_begins() const -> decltype(auto)
@@ -47,6 +47,13 @@ template<class T> constexpr T na()
   }
 };
 
+/// The NA value for the types with NA, T() for the others. For the
+/// results which are not available yet, e.g. of a filter which is not ready.
+template<class T> T na_or_default()
+{
+  return can_na<T>() ? na<T>() : T();
+}
+
 } // namespace na
 
 } // namespace ts
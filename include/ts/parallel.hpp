@@ -0,0 +1,89 @@
+// parallel.hpp - running independent tasks on several threads.
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace ts {
+
+namespace impl {
+
+/// Number of threads used when the caller asks for 0 threads.
+inline size_t default_n_threads()
+{
+  auto n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+/// Calls f(i) for all i in [0, n_tasks) using up to n_threads threads
+/// (0 means one per core). The calling thread is one of them.
+///
+/// The tasks are handed out one by one from a shared counter so a thread
+/// which finished its task takes the next one and tasks of uneven cost
+/// are balanced. The first exception thrown by a task is rethrown once
+/// all the threads have finished; the remaining tasks are skipped.
+template<class Function>
+void parallel_for(size_t n_tasks, size_t n_threads, Function f)
+{
+  if (n_threads == 0) n_threads = default_n_threads();
+  if (n_threads > n_tasks) n_threads = n_tasks;
+
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < n_tasks; i = next++) {
+      try {
+        f(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        next = n_tasks;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t t=1; t < n_threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& t: threads) t.join();
+  if (error) std::rethrow_exception(error);
+}
+
+} // namespace impl
+
+
+/// Applies a functor made by factory() to the (timestamp, value) pairs of
+/// each series of a collection of pointers to series (e.g. SeriesCollection)
+/// using n_threads threads (0 means one per core). NA values are skipped.
+///
+/// Each series gets its own functor, typically an Accumulator around a
+/// filter, so the threads share no state. The series are handed out one by
+/// one as in impl::parallel_for so a thread done with short series takes
+/// over the rest. Returns the values of the functors (e.g. the output series
+/// of the Accumulators) in the order of the input series.
+template<class SeriesPtrs, class Factory>
+auto apply_each_parallel(const SeriesPtrs& series, Factory factory,
+                         size_t n_threads=0)
+  -> std::vector<typename std::decay<decltype(factory().value())>::type>
+{
+  using result_type = typename std::decay<decltype(factory().value())>::type;
+  std::vector<result_type> results(series.size());
+  impl::parallel_for(series.size(), n_threads, [&](size_t i) {
+    auto f = factory();
+    results[i] = series[i]->apply_pairs(f).value();
+  });
+  return results;
+}
+
+} // namespace ts
+
+#endif /* PARALLEL_HPP */
@@ -3,7 +3,6 @@
 #ifndef PRINTING_HPP
 #define PRINTING_HPP
 
-#include <map>
 #include <iomanip>
 #include <ios>
 #include <initializer_list>
@@ -49,38 +48,21 @@ template<typename Series> class SeriesPrinter;
 }
 
 
-/// Prints a collection of series.
-template<class Timestamp, class Value>
+/// Prints a collection of series (or of series views).
+template<class S>
 void print(std::ostream& s,
-           std::vector<const Series<Timestamp, Value>* >& pseries,
+           const std::vector<const S*>& pseries,
            SeriesPrintSettings settings=SeriesPrintSettings())
 {
-  typedef Series<Timestamp, Value> S;
   auto p = impl::SeriesPrinter<S>(settings);
-  //auto mergeitr = col.merge_iterator();
-  auto mergeitr = MergeIterator<S>::from_series_ptrs(pseries);
-  const int N = mergeitr.n_series();
-  typename S::timestamp_type curind;
-  std::map<int, typename S::value_type> vals;
+  auto row = AlignedMergeIterator<S>::from_series_ptrs(pseries);
+  const int N = row.n_series();
 
   p.print_header(s, N);
-  // the main loop over the values
-  if (mergeitr) curind = mergeitr.timestamp();
-  while (mergeitr)
-  {
-    if (curind != mergeitr.timestamp()) {
-      // print all the values collected for the previous index
-      p.print_values(s, curind, vals, N);
-      // clear the collected values
-      vals.clear();
-      // remember the new index
-      curind = mergeitr.timestamp();
-    }
-    // remember the current observation
-    vals[mergeitr.series()] = mergeitr.value();
-    ++mergeitr;
+  // the main loop over the distinct timestamps
+  for (; row; ++row) {
+    p.print_values(s, row.timestamp(), row, N);
   }
-  p.print_values(s, curind, vals, N);
 }
 
 
@@ -109,6 +91,31 @@ void print(std::ostream& s,
 }
 
 
+/// Prints one series view.
+template<typename Timestamp, typename Value>
+void print(std::ostream& s,
+           const SeriesView<Timestamp, Value>& x,
+           SeriesPrintSettings settings=SeriesPrintSettings())
+{
+  typedef SeriesView<Timestamp, Value> S;
+  std::vector<const S*> col;
+  col.push_back(&x);
+  print(s, col, settings);
+}
+
+
+/// Prints series views given an initializer list.
+template<typename Timestamp, typename Value>
+void print(std::ostream& s,
+           std::initializer_list<const SeriesView<Timestamp, Value>*> list,
+           SeriesPrintSettings settings=SeriesPrintSettings())
+{
+  typedef SeriesView<Timestamp, Value> S;
+  std::vector<const S*> col(list);
+  print(s, col, settings);
+}
+
+
 namespace impl {
 
 // Implementation of the printer class
@@ -142,15 +149,15 @@ class SeriesPrinter
     s << std::string(len, '-') << std::endl;
   }
 
-  /// Prints the values at a given timestamp.
-  template<class Stream, class Timestamp, class ValuesMap>
-  void print_values(Stream& s, Timestamp ts, ValuesMap vals, int n_series)
+  /// Prints the values at a given timestamp from an aligned row.
+  template<class Stream, class Timestamp, class Row>
+  void print_values(Stream& s, Timestamp ts, const Row& row, int n_series)
   {
     print_one(s, ts, set.index_width);
     print_one(s, set.index_value_sep);
     for (int i=0; i < n_series; ++i){
-       if (vals.count(i) > 0) {
-        print_one(s, vals[i], set.values_width);
+       if (row.present(i)) {
+        print_one(s, row.values()[i], set.values_width);
       } else {
         print_one(s, "", set.values_width);
       }     
@@ -0,0 +1,419 @@
+// reader.hpp - reading series from CSV and binary files.
+
+#ifndef READER_HPP
+#define READER_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/parallel.hpp>
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+/// The format of the CSV files read by read_csv().
+struct CsvOptions
+{
+  char separator = ',';       ///< The field separator
+  bool header = false;        ///< Is the first line a header?
+  size_t time_column = 0;     ///< The field holding the timestamps
+  size_t value_column = 1;    ///< The field holding the values
+  size_t n_threads = 0;       ///< Parsing threads (0 means one per core)
+  size_t block_size = 1 << 26; ///< Bytes read from the file at once
+};
+
+
+namespace impl {
+
+/// Parses the integer in [first, last). Returns false if the text is not
+/// an integer or it does not fit T.
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type
+parse_number(const char* first, const char* last, T& out)
+{
+  bool neg = false;
+  if (first < last && (*first == '-' || *first == '+')) {
+    neg = *first == '-';
+    ++first;
+  }
+  if (first == last) return false;
+  uint64_t m = 0;
+  for (; first < last; ++first) {
+    unsigned d = *first - '0';
+    if (d > 9) return false;
+    if (__builtin_mul_overflow(m, 10, &m) || __builtin_add_overflow(m, d, &m))
+      return false;
+  }
+  if (neg) {
+    if (!std::is_signed<T>::value && m > 0) return false;
+    if (m > uint64_t(std::numeric_limits<T>::max()) + 1) return false;
+    out = static_cast<T>(0 - m);
+  } else {
+    if (m > uint64_t(std::numeric_limits<T>::max())) return false;
+    out = static_cast<T>(m);
+  }
+  return true;
+}
+
+/// Parses the decimal number in [first, last) with strtod. Also accepts
+/// NA for NA. Whitespace is rejected at both ends like in the integers
+/// (strtod would skip it at the beginning only).
+inline bool parse_double_slow(const char* first, const char* last,
+                              double& out)
+{
+  if (first == last || std::isspace(static_cast<unsigned char>(*first)))
+    return false;
+  std::string text(first, last);
+  if (text == "NA") {
+    out = na::na<double>();
+    return true;
+  }
+  char* end;
+  out = std::strtod(text.c_str(), &end);
+  return end == text.c_str() + text.size();
+}
+
+/// Parses the floating-point number in [first, last); an empty text is NA.
+///
+/// The numbers with at most 19 significant digits whose mantissa fits 53
+/// bits and whose decimal exponent is at most 22 in absolute value (the vast
+/// majority of the prices and sizes in the data files) are computed exactly
+/// by one multiplication or division of two exact doubles, see
+///
+/// Clinger, W. D. (1990). "How to Read Floating Point Numbers Accurately".
+/// PLDI '90.
+///
+/// The other ones go to strtod.
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+parse_number(const char* first, const char* last, T& out)
+{
+  static const double powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  if (first == last) {
+    out = na::na<T>();
+    return true;
+  }
+  const char* p = first;
+  bool neg = false;
+  if (*p == '-' || *p == '+') {
+    neg = *p == '-';
+    ++p;
+  }
+  uint64_t m = 0;
+  int digits = 0, exp10 = 0;
+  bool any = false;
+  for (; p < last && unsigned(*p - '0') <= 9; ++p, any = true) {
+    if (digits < 19) {
+      m = m * 10 + (*p - '0');
+      if (m != 0) ++digits;
+    } else {
+      ++exp10;
+    }
+  }
+  if (p < last && *p == '.') {
+    for (++p; p < last && unsigned(*p - '0') <= 9; ++p, any = true) {
+      if (digits < 19) {
+        m = m * 10 + (*p - '0');
+        if (m != 0) ++digits;
+        --exp10;
+      }
+    }
+  }
+  if (any && p < last && (*p == 'e' || *p == 'E')) {
+    int e = 0;
+    if (!parse_number(p + 1, last, e)) return false;
+    exp10 += std::max(-1000, std::min(1000, e));
+    p = last;
+  }
+  double res;
+  if (!any || p != last || digits == 19 || m > (uint64_t(1) << 53)
+      || exp10 < -22 || exp10 > 22) {
+    if (!parse_double_slow(first, last, res)) return false;
+  } else {
+    res = exp10 < 0 ? m / powers[-exp10] : m * powers[exp10];
+    if (neg) res = -res;
+  }
+  out = static_cast<T>(res);
+  return true;
+}
+
+/// The columns parsed from a part of a file.
+template<typename Timestamp, typename Value>
+struct ParsedChunk
+{
+  std::vector<Timestamp> index;
+  std::vector<Value> values;
+  bool sorted = true; ///< Is the index of the chunk sorted?
+};
+
+/// The text of a line for the error messages
+inline std::string quote_line(const char* first, const char* last)
+{
+  return "'" + std::string(first, std::min(last, first + 60)) + "'";
+}
+
+/// Parses the CSV lines in [first, last) (the last one ending by a newline
+/// or at last) into the chunk. The blank lines are skipped.
+template<typename Timestamp, typename Value>
+void parse_csv_lines(const char* first, const char* last,
+                     const CsvOptions& opts,
+                     ParsedChunk<Timestamp, Value>& chunk)
+{
+  const size_t n_lines = std::count(first, last, '\n') + 1;
+  chunk.index.reserve(n_lines);
+  chunk.values.reserve(n_lines);
+  const size_t n_fields = std::max(opts.time_column, opts.value_column) + 1;
+  const char* fields[2 * 64]; // the start and the end of each field
+  if (n_fields > 64) throw IoError("read_csv(): too many columns");
+
+  while (first < last) {
+    auto eol = static_cast<const char*>(
+        std::memchr(first, '\n', last - first));
+    if (!eol) eol = last;
+    auto end = eol;
+    if (end > first && end[-1] == '\r') --end;
+    if (end > first) {
+      // split the fields we need
+      size_t k = 0;
+      const char* p = first;
+      while (k < n_fields) {
+        auto sep = static_cast<const char*>(
+            std::memchr(p, opts.separator, end - p));
+        fields[2 * k] = p;
+        fields[2 * k + 1] = sep ? sep : end;
+        ++k;
+        if (!sep) break;
+        p = sep + 1;
+      }
+      if (k < n_fields)
+        throw IoError("read_csv(): missing field in "
+                      + quote_line(first, end));
+      Timestamp t;
+      Value v;
+      if (!parse_number(fields[2 * opts.time_column],
+                        fields[2 * opts.time_column + 1], t)
+          || !parse_number(fields[2 * opts.value_column],
+                           fields[2 * opts.value_column + 1], v))
+        throw IoError("read_csv(): cannot parse " + quote_line(first, end));
+      if (na::can_na<Timestamp>() && na::is_na(t))
+        throw IoError("read_csv(): NA timestamp in " + quote_line(first, end));
+      if (!chunk.index.empty() && t < chunk.index.back()) chunk.sorted = false;
+      chunk.index.push_back(t);
+      chunk.values.push_back(v);
+    }
+    first = eol + 1;
+  }
+}
+
+/// Appends the chunks to the columns checking that the result is sorted.
+template<typename Timestamp, typename Value>
+void append_chunks(std::vector<ParsedChunk<Timestamp, Value> >& chunks,
+                   std::vector<Timestamp>& index, std::vector<Value>& values)
+{
+  for (auto& c: chunks) {
+    if (!c.sorted || (!c.index.empty() && !index.empty()
+                      && c.index.front() < index.back()))
+      throw IndexNotSorted("The timestamps in the file are not sorted.");
+    index.insert(index.end(), c.index.begin(), c.index.end());
+    values.insert(values.end(), c.values.begin(), c.values.end());
+  }
+}
+
+/// The size of a file
+inline uint64_t file_size(std::ifstream& in, const std::string& path)
+{
+  in.seekg(0, std::ios::end);
+  auto size = in.tellg();
+  in.seekg(0, std::ios::beg);
+  if (size < 0) throw IoError("cannot get the size of " + path);
+  return static_cast<uint64_t>(size);
+}
+
+} // namespace impl
+
+
+/// Reads a series from a CSV file with one observation per line.
+///
+/// The file is read in blocks of opts.block_size bytes and each block is
+/// split at line boundaries into one part per thread. The parts are parsed
+/// in parallel into columns pre-sized by their number of lines, checking
+/// that the timestamps are sorted on the way, so the series is built
+/// without another scan of its index. Empty value fields (and NA) are NA.
+/// Throws IoError on the lines which cannot be parsed and IndexNotSorted if
+/// the timestamps decrease.
+template<typename Timestamp, typename Value=double>
+Series<Timestamp, Value> read_csv(const std::string& path,
+                                  const CsvOptions& opts=CsvOptions())
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw IoError("read_csv(): cannot open " + path);
+  const uint64_t size = impl::file_size(in, path);
+  const size_t n_threads = opts.n_threads ? opts.n_threads
+                                          : impl::default_n_threads();
+  const size_t block_size = std::max<size_t>(opts.block_size, 1 << 12);
+
+  std::vector<Timestamp> index;
+  std::vector<Value> values;
+  std::vector<char> buf;
+  size_t carry = 0; // the bytes of an incomplete line from the last block
+  uint64_t read = 0;
+  bool skip_header = opts.header;
+  while (read < size || carry > 0) {
+    auto n = static_cast<size_t>(std::min<uint64_t>(block_size, size - read));
+    buf.resize(carry + n);
+    in.read(buf.data() + carry, n);
+    if (static_cast<size_t>(in.gcount()) != n)
+      throw IoError("read_csv(): cannot read " + path);
+    read += n;
+    const char* first = buf.data();
+    const char* end = buf.data() + buf.size();
+    // the complete lines, or everything at the end of the file
+    const char* last = end;
+    if (read < size) {
+      while (last > first && last[-1] != '\n') --last;
+      if (last == first) { // a line longer than the block
+        carry = buf.size();
+        continue;
+      }
+    }
+    if (skip_header) {
+      auto eol = static_cast<const char*>(
+          std::memchr(first, '\n', last - first));
+      first = eol ? eol + 1 : last;
+      skip_header = false;
+    }
+
+    // split at line boundaries
+    std::vector<const char*> bounds(1, first);
+    for (size_t k=1; k < n_threads; ++k) {
+      const char* p = std::max(bounds.back(),
+                               first + (last - first) * k / n_threads);
+      auto eol = static_cast<const char*>(std::memchr(p, '\n', last - p));
+      bounds.push_back(eol ? eol + 1 : last);
+    }
+    bounds.push_back(last);
+
+    std::vector<impl::ParsedChunk<Timestamp, Value> > chunks(n_threads);
+    impl::parallel_for(n_threads, n_threads, [&](size_t k) {
+      impl::parse_csv_lines(bounds[k], bounds[k + 1], opts, chunks[k]);
+    });
+    if (index.empty() && read < size) {
+      // reserve for the whole file extrapolating the first block
+      size_t n_parsed = 0;
+      for (auto& c: chunks) n_parsed += c.index.size();
+      auto expected = static_cast<size_t>(
+          double(n_parsed) * size / (last - buf.data()) * 1.05 + 16);
+      index.reserve(expected);
+      values.reserve(expected);
+    }
+    impl::append_chunks(chunks, index, values);
+
+    carry = end - last;
+    std::memmove(buf.data(), last, carry);
+  }
+  return Series<Timestamp, Value>::from_sorted(std::move(index),
+                                               std::move(values));
+}
+
+
+/// Writes a series to a binary file of fixed-width records, each made of
+/// the raw bytes of the timestamp followed by the raw bytes of the value.
+template<typename Timestamp, typename Value>
+void write_binary(const std::string& path, const Series<Timestamp, Value>& x)
+{
+  static_assert(std::is_trivially_copyable<Timestamp>::value
+                && std::is_trivially_copyable<Value>::value,
+                "write_binary(): the types must be trivially copyable");
+  const size_t rec = sizeof(Timestamp) + sizeof(Value);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw IoError("write_binary(): cannot open " + path);
+  std::vector<char> buf;
+  const size_t block = 1 << 16;
+  for (size_t i=0; i < x.size(); i += block) {
+    size_t n = std::min(block, x.size() - i);
+    buf.resize(n * rec);
+    for (size_t j=0; j < n; ++j) {
+      std::memcpy(&buf[j * rec], x.index_data() + i + j, sizeof(Timestamp));
+      std::memcpy(&buf[j * rec + sizeof(Timestamp)], x.values_data() + i + j,
+                  sizeof(Value));
+    }
+    out.write(buf.data(), buf.size());
+  }
+  if (!out) throw IoError("write_binary(): cannot write " + path);
+}
+
+
+/// Reads a series from a binary file written by write_binary().
+///
+/// The number of records is known from the size of the file so the columns
+/// are allocated once. The file is read in blocks of block_size bytes and
+/// the records of each block are unpacked by n_threads threads (0 means one
+/// per core) straight into the columns, checking that the timestamps are
+/// sorted on the way. Throws IndexNotSorted if they decrease.
+template<typename Timestamp, typename Value=double>
+Series<Timestamp, Value> read_binary(const std::string& path,
+                                     size_t n_threads=0,
+                                     size_t block_size=1 << 26)
+{
+  const size_t rec = sizeof(Timestamp) + sizeof(Value);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw IoError("read_binary(): cannot open " + path);
+  const uint64_t size = impl::file_size(in, path);
+  if (size % rec != 0)
+    throw IoError("read_binary(): " + path + " has a partial record");
+  if (n_threads == 0) n_threads = impl::default_n_threads();
+  const size_t block_records = std::max<size_t>(block_size / rec, 1);
+
+  const size_t count = size / rec;
+  std::vector<Timestamp> index(count);
+  std::vector<Value> values(count);
+  std::vector<char> buf;
+  std::vector<char> sorted(n_threads);
+  for (size_t start=0; start < count; start += block_records) {
+    const size_t n = std::min(block_records, count - start);
+    buf.resize(n * rec);
+    in.read(buf.data(), buf.size());
+    if (static_cast<size_t>(in.gcount()) != buf.size())
+      throw IoError("read_binary(): cannot read " + path);
+    impl::parallel_for(n_threads, n_threads, [&](size_t k) {
+      size_t from = n * k / n_threads, to = n * (k + 1) / n_threads;
+      bool ok = true;
+      for (size_t j=from; j < to; ++j) {
+        Timestamp t;
+        std::memcpy(&t, &buf[j * rec], sizeof(Timestamp));
+        std::memcpy(&values[start + j], &buf[j * rec + sizeof(Timestamp)],
+                    sizeof(Value));
+        index[start + j] = t;
+        if (j > from && t < index[start + j - 1]) ok = false;
+      }
+      sorted[k] = ok;
+    });
+    // the boundaries of the parts and of the blocks
+    for (size_t k=0; k < n_threads; ++k) {
+      size_t from = start + n * k / n_threads;
+      if (!sorted[k] || (from > 0 && from < start + n
+                         && index[from] < index[from - 1]))
+        throw IndexNotSorted("The timestamps in the file are not sorted.");
+    }
+  }
+  return Series<Timestamp, Value>::from_sorted(std::move(index),
+                                               std::move(values));
+}
+
+} // namespace ts
+
+#endif /* READER_HPP */
@@ -0,0 +1,219 @@
+// resample.hpp - bucketing a series into fixed time bars.
+
+#ifndef RESAMPLE_HPP
+#define RESAMPLE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ts/exceptions.hpp>
+#include <ts/aggregators.hpp>
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+namespace impl {
+
+/// The start of the bar of a given width containing the integral
+/// timestamp t, i.e. the greatest multiple of width not greater than t.
+template<typename Timestamp, typename Duration>
+typename std::enable_if<std::is_integral<Timestamp>::value, Timestamp>::type
+bar_start(Timestamp t, Duration width)
+{
+  Timestamp r = t % width;
+  return r < 0 ? t - r - width : t - r;
+}
+
+/// The start of the bar of a given width containing the floating-point
+/// timestamp t, i.e. the greatest multiple of width not greater than t.
+template<typename Timestamp, typename Duration>
+typename std::enable_if<std::is_floating_point<Timestamp>::value,
+                        Timestamp>::type
+bar_start(Timestamp t, Duration width)
+{
+  return std::floor(t / width) * width;
+}
+
+/// The maximum number of bars of a given width needed for the sorted
+/// index: no more than the observations or the bars spanned by the index.
+template<typename Timestamp, typename Duration>
+size_t max_bars(const std::vector<Timestamp>& index, Duration width)
+{
+  if (index.empty()) return 0;
+  size_t n_bars = index.size();
+  double span = double(index.back() - index.front()) / width + 1;
+  if (span < n_bars) n_bars = static_cast<size_t>(span) + 1;
+  return n_bars;
+}
+
+/// The streaming pass of the resampling: aggregates the values of x in the
+/// bars of a given width with fresh copies of agg and calls
+/// output(bar_start, aggregator) once per non-empty bar.
+template<typename Timestamp, typename Value, typename Duration,
+         typename Aggregator, typename Output>
+void resample_into(const Series<Timestamp, Value>& x, Duration width,
+                   const Aggregator& agg, Output& output)
+{
+  if (!(width > 0)) throw TsException("resample(): width must be positive");
+  const auto& index = x.indexView();
+  const auto& values = x.valuesView();
+  if (index.empty()) return;
+
+  auto cur = agg;
+  Timestamp start = bar_start(index[0], width);
+  Timestamp end = start + width;
+  for (size_t i=0; i < index.size(); ++i) {
+    if (!(index[i] < end)) {
+      output(start, cur);
+      cur = agg;
+      start = bar_start(index[i], width);
+      end = start + width;
+    }
+    cur(values[i]);
+  }
+  output(start, cur);
+}
+
+} // namespace impl
+
+
+/// Aggregates the values of a series in the bars [k width, (k+1) width).
+///
+/// Returns the series of the aggregated values labelled by the starts of
+/// the bars. Each bar gets a fresh copy of agg. The bars without any
+/// observation are left out. The series is processed in one pass and the
+/// output is allocated once for the maximum possible number of bars.
+template<typename Aggregator, typename Timestamp, typename Value,
+         typename Duration>
+auto resample(const Series<Timestamp, Value>& x, Duration width,
+              const Aggregator& agg=Aggregator())
+  -> Series<Timestamp, typename std::decay<decltype(agg.value())>::type>
+{
+  using output_type = typename std::decay<decltype(agg.value())>::type;
+  std::vector<Timestamp> bars;
+  std::vector<output_type> out;
+  bars.reserve(impl::max_bars(x.indexView(), width));
+  out.reserve(bars.capacity());
+  auto output = [&](Timestamp start, const Aggregator& a) {
+    bars.push_back(start);
+    out.push_back(a.value());
+  };
+  impl::resample_into(x, width, agg, output);
+  return Series<Timestamp, output_type>(std::move(bars), std::move(out));
+}
+
+
+/// Resamples with the aggregator template (e.g. Sum, Ohlc) instantiated
+/// with the value type of the series, e.g. resample<Ohlc>(x, 60).
+template<template<typename> class Aggregator=Sum, typename Timestamp,
+         typename Value, typename Duration>
+auto resample(const Series<Timestamp, Value>& x, Duration width)
+  -> decltype(resample(x, width, Aggregator<Value>()))
+{
+  return resample(x, width, Aggregator<Value>());
+}
+
+
+/// Bars made by several aggregators stored as columns sharing one index.
+///
+/// The I-th column holds the values of the I-th aggregator; series<I>()
+/// makes a series of it.
+template<typename Timestamp, typename... Aggregators>
+class Bars
+{
+  template<class Aggregator>
+  using value_t = typename std::decay<
+    decltype(std::declval<const Aggregator&>().value())>::type;
+
+ public:
+  using columns_type = std::tuple<std::vector<value_t<Aggregators> >...>;
+
+  /// Number of bars
+  size_t size() const { return index_.size(); }
+
+  /// The starts of the bars
+  const std::vector<Timestamp>& index() const { return index_; }
+
+  /// The values of the I-th aggregator
+  template<size_t I>
+  const typename std::tuple_element<I, columns_type>::type& column() const
+  {
+    return std::get<I>(columns_);
+  }
+
+  /// The series of the values of the I-th aggregator (copies the index)
+  template<size_t I>
+  auto series() const -> decltype(auto)
+  {
+    using value_type =
+      typename std::tuple_element<I, columns_type>::type::value_type;
+    return Series<Timestamp, value_type>(index_, column<I>());
+  }
+
+  /// Allocates the storage for n bars
+  void reserve(size_t n)
+  {
+    index_.reserve(n);
+    reserve(n, std::index_sequence_for<Aggregators...>());
+  }
+
+  /// Appends a bar
+  void push_back(Timestamp start, const Fused<Aggregators...>& agg)
+  {
+    index_.push_back(start);
+    push_back(agg, std::index_sequence_for<Aggregators...>());
+  }
+
+ private:
+
+  template<size_t... I>
+  void reserve(size_t n, std::index_sequence<I...>)
+  {
+    int dummy[] = {0, (std::get<I>(columns_).reserve(n), 0)...};
+    (void)dummy;
+  }
+
+  template<size_t... I>
+  void push_back(const Fused<Aggregators...>& agg, std::index_sequence<I...>)
+  {
+    int dummy[] = {
+      0, (std::get<I>(columns_).push_back(agg.template get<I>().value()), 0)...
+    };
+    (void)dummy;
+  }
+
+  std::vector<Timestamp> index_; ///< The starts of the bars
+  columns_type columns_;         ///< The values of the aggregators
+};
+
+
+/// Aggregates the values of a series in the bars [k width, (k+1) width)
+/// with several aggregators at once, e.g.
+///
+///     resample_fused<Field<0, Ohlc<> >, Field<1, Sum<> >, Vwap<> >(trades, 60)
+///
+/// for a series of (price, volume) pairs. Every value is passed to all the
+/// aggregators in the same pass and the results are stored as columns
+/// sharing one index. Otherwise works as resample().
+template<typename... Aggregators, typename Timestamp, typename Value,
+         typename Duration>
+Bars<Timestamp, Aggregators...>
+resample_fused(const Series<Timestamp, Value>& x, Duration width)
+{
+  Bars<Timestamp, Aggregators...> bars;
+  bars.reserve(impl::max_bars(x.indexView(), width));
+  auto output = [&](Timestamp start, const Fused<Aggregators...>& a) {
+    bars.push_back(start, a);
+  };
+  impl::resample_into(x, width, Fused<Aggregators...>(), output);
+  return bars;
+}
+
+} // namespace ts
+
+#endif /* RESAMPLE_HPP */
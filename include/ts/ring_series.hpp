@@ -0,0 +1,290 @@
+// ring_series.hpp - series keeping a bounded window of the newest points
+
+#ifndef RING_SERIES_HPP
+#define RING_SERIES_HPP
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ts/exceptions.hpp>
+#include <ts/na.hpp>
+#include <ts/series.hpp>
+
+
+namespace ts {
+
+namespace impl {
+
+/// Paired (index, value) iterator over a ring of observations going from
+/// the oldest to the newest one.
+template<typename Timestamp, typename Value>
+class RingIter
+{
+ public:
+  typedef RingIter<Timestamp, Value> this_type;
+
+  RingIter(): index_(nullptr), values_(nullptr), cap_(0), pos_(0), n_(0) {}
+
+  /// Points to the n-th oldest observation stored at the position pos of
+  /// the arrays of cap timestamps and values
+  RingIter(const Timestamp* index, const Value* values, size_t cap,
+           size_t pos, size_t n)
+    : index_(index),
+      values_(values),
+      cap_(cap),
+      pos_(pos),
+      n_(n)
+  {}
+
+  /// Prefix increment
+  this_type& operator++()
+  {
+    if (++pos_ == cap_) pos_ = 0;
+    ++n_;
+    return *this;
+  }
+
+  /// Postfix increment
+  this_type operator++(int)
+  {
+    auto old = *this;
+    operator++();
+    return old;
+  }
+
+  bool operator==(const this_type& other) const { return n_ == other.n_; }
+
+  bool operator!=(const this_type& other) const { return n_ != other.n_; }
+
+  /// Index at the current position
+  const Timestamp& index() const { return index_[pos_]; }
+
+  /// Value at the current position
+  const Value& value() const { return values_[pos_]; }
+
+ private:
+  const Timestamp* index_; ///< The ring of timestamps
+  const Value* values_;    ///< The ring of values
+  size_t cap_;             ///< The length of the rings
+  size_t pos_;             ///< The position in the rings
+  size_t n_;               ///< Number of observations before the current
+};
+
+} // namespace impl
+
+
+/// A time series keeping at most capacity newest observations.
+///
+/// The index and the values are stored in two rings allocated once at the
+/// construction. When the series is full appending overwrites the oldest
+/// observation so the memory stays fixed and nothing is moved. The
+/// observations thus occupy two contiguous parts of the rings, the older
+/// one starting at the oldest observation and the newer one wrapped to the
+/// beginning, which are available as views and searched by at().
+///
+/// The paired iteration goes from the oldest to the newest observation so
+/// the ring series can be merged (MergeIterator) and fed to the filters and
+/// accumulators like the Series. The two parts are the segments of
+/// impl::SegmentedBase which provides the application of functors,
+/// parallel_apply(), the moments and at_many().
+template<typename Timestamp, typename Value=double>
+class RingSeries
+  : public impl::SegmentedBase<RingSeries<Timestamp, Value>, Timestamp, Value>
+{
+ public: // declarations and consts
+
+  typedef RingSeries<Timestamp, Value> this_type;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef impl::RingIter<Timestamp, Value> paired_iterator_type;
+
+ private: // variables
+
+  std::vector<Timestamp> index_; ///< The ring of timestamps
+  std::vector<Value> values_;    ///< The ring of values
+  size_t head_;                  ///< The position of the oldest observation
+  size_t size_;                  ///< Number of observations
+
+ public: // methods
+
+  /// Creates an empty series keeping at most capacity observations
+  RingSeries(size_t capacity)
+    : index_(capacity),
+      values_(capacity),
+      head_(0),
+      size_(0)
+  {
+    if (capacity < 1)
+      throw TsException("RingSeries(): capacity must be at least 1");
+  }
+
+  /// Returns the number of the observations kept
+  size_t size() const { return size_; }
+
+  /// The maximum number of the observations kept
+  size_t capacity() const { return index_.size(); }
+
+  /// Are there capacity observations already?
+  bool full() const { return size_ == capacity(); }
+
+  /// Is the series empty?
+  bool empty() const { return size_ == 0; }
+
+  /// The oldest timestamp kept. No checks.
+  const Timestamp& front_index() const { return index_[head_]; }
+
+  /// The newest timestamp. No checks.
+  const Timestamp& back_index() const { return index_[physical(size_ - 1)]; }
+
+  /// Adds a new observation at the end evicting the oldest one if the
+  /// series is full. Throws an IndexNotSorted exception if the new
+  /// observation's index is not greater than the last one.
+  void append(Timestamp ix, Value val)
+  {
+    if (size_ > 0 && ix <= back_index()) {
+      throw IndexNotSorted(
+        "Appending with a timestamp not greater than the last index element."
+      );
+    }
+    append_unchecked(ix, val);
+  }
+
+  /// Adds a new observation at the end without checking the timestamp.
+  /// For the trusted sources which guarantee the order.
+  void append_unchecked(Timestamp ix, Value val)
+  {
+    size_t pos;
+    if (full()) {
+      pos = head_;
+      if (++head_ == capacity()) head_ = 0;
+    } else {
+      pos = physical(size_++);
+    }
+    index_[pos] = ix;
+    values_[pos] = val;
+  }
+
+  /// Evicts the observations with timestamps less than t (e.g. older than
+  /// the retention period) by a binary search.
+  void trim_before(Timestamp t)
+  {
+    auto older = older_part(), newer = newer_part();
+    size_t n = std::lower_bound(older.indexView().begin(),
+                                older.indexView().end(), t)
+               - older.indexView().begin();
+    if (n == older.size()) {
+      n += std::lower_bound(newer.indexView().begin(),
+                            newer.indexView().end(), t)
+           - newer.indexView().begin();
+    }
+    head_ = physical(n);
+    size_ -= n;
+    if (size_ == 0) head_ = 0;
+  }
+
+  /// Evicts all the observations
+  void clear()
+  {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /// The older contiguous part of the observations starting at the oldest
+  /// one. Valid until the next append.
+  SeriesView<Timestamp, Value> older_part() const
+  {
+    size_t n = std::min(size_, capacity() - head_);
+    return SeriesView<Timestamp, Value>(&index_[head_], &values_[head_], n);
+  }
+
+  /// The newer contiguous part of the observations, i.e. those wrapped to
+  /// the beginning of the rings (possibly empty). Valid until the next
+  /// append.
+  SeriesView<Timestamp, Value> newer_part() const
+  {
+    size_t n = size_ - std::min(size_, capacity() - head_);
+    return SeriesView<Timestamp, Value>(index_.data(), values_.data(), n);
+  }
+
+  /// Number of segments (see impl::SegmentedBase): the two parts
+  size_t n_segments() const { return 2; }
+
+  /// The older (0) or the newer (1) part of the observations
+  impl::Segment<Timestamp, Value> segment(size_t i) const
+  {
+    auto part = i == 0 ? older_part() : newer_part();
+    return {part.index_data(), part.values_data(), part.size()};
+  }
+
+  /// Finds the value corresponding to a given index value by a binary
+  /// search in the part which may hold it
+  Value& at(Timestamp x)
+  {
+    auto older = older_part();
+    auto part = older.size() > 0 && !(older.indexView().back() < x)
+                ? older : newer_part();
+    auto begin = part.indexView().begin(), end = part.indexView().end();
+    auto loc = impl::timestamp_lower_bound(begin, end, x);
+    if (loc == end){
+      throw IndexError<Timestamp>(x);
+    }
+    return values_[loc - index_.data()];
+  }
+
+  /// Finds the value corresponding to a given index value
+  Value& operator[](Timestamp x){ return at(x); }
+
+  /// Paired (index, value) iterators to the oldest observation
+  paired_iterator_type begin_paired() const
+  {
+    return paired_iterator_type(index_.data(), values_.data(), capacity(),
+                                head_, 0);
+  }
+
+  /// Paired (index, value) iterators to the end
+  paired_iterator_type end_paired() const
+  {
+    return paired_iterator_type(index_.data(), values_.data(), capacity(),
+                                physical(size_), size_);
+  }
+
+  /// Copies the observations from the oldest one to a new series
+  Series<Timestamp, Value> to_series() const
+  {
+    std::vector<Timestamp> index;
+    std::vector<Value> values;
+    index.reserve(size_);
+    values.reserve(size_);
+    for (auto c = begin_paired(); c != end_paired(); ++c) {
+      index.push_back(c.index());
+      values.push_back(c.value());
+    }
+    return Series<Timestamp, Value>::from_sorted(std::move(index),
+                                                 std::move(values));
+  }
+
+  /// Convert to a human-readable string
+  std::string to_string(std::string sep=std::string(", ")) const
+  {
+    std::ostringstream out;
+    for (auto c = begin_paired(); c != end_paired(); ++c) {
+      out << c.index() << ":" << c.value() << sep;
+    }
+    return out.str();
+  }
+
+ private: // methods
+
+  /// The position in the rings of the n-th oldest observation
+  size_t physical(size_t n) const
+  {
+    size_t pos = head_ + n;
+    return pos < capacity() ? pos : pos - capacity();
+  }
+};
+
+} // namespace ts
+
+#endif /* RING_SERIES_HPP */
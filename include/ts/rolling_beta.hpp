@@ -0,0 +1,91 @@
+// rolling_beta.hpp - rolling betas and correlations of many series against
+// one series.
+
+#ifndef ROLLING_BETA_HPP
+#define ROLLING_BETA_HPP
+
+#include <vector>
+
+#include <ts/aggregators.hpp>
+#include <ts/merge.hpp>
+#include <ts/series.hpp>
+#include <ts/filters/time_window.hpp>
+
+
+namespace ts {
+
+/// The rolling betas and correlations of several series, one series of
+/// each per input series.
+template<typename Timestamp>
+struct RollingBetas
+{
+  std::vector<Series<Timestamp, double> > beta; ///< The betas
+  std::vector<Series<Timestamp, double> > corr; ///< The correlations
+};
+
+
+/// Rolling betas and correlations of the series ys against the series x
+/// over the windows of the last window_length time units.
+///
+/// All the series are aligned in one merge pass. Each series of ys is
+/// paired with x as in cov(): the values of both series are aggregated by
+/// Aggregator (e.g. returns summed by Sum) until their timestamps coincide
+/// and the aggregated pair then enters the time window of the series (see
+/// filters::TimeRollingCov), the oldest pairs leaving it. Each window is
+/// updated in O(1) per pair instead of being recomputed from a slice.
+///
+/// The beta (the slope of the regression of y on x) and the correlation are
+/// output at the timestamps of the pairs once the window of the series is
+/// covered by its history.
+template<template<typename> class Aggregator=Sum, typename Series,
+         typename Duration>
+RollingBetas<typename Series::timestamp_type>
+rolling_beta(const Series& x, const std::vector<const Series*>& ys,
+             Duration window_length)
+{
+  using timestamp_type = typename Series::timestamp_type;
+  using value_type = typename Series::value_type;
+  using Agg = Aggregator<value_type>;
+  using AggResult = decltype(Agg().value());
+  const size_t N = ys.size();
+
+  std::vector<filters::TimeRollingCov<timestamp_type, Duration> > windows(
+      N, filters::TimeRollingCov<timestamp_type, Duration>(window_length)
+  );
+  std::vector<Agg> aggx(N), aggy(N);
+  RollingBetas<timestamp_type> res;
+  res.beta.resize(N);
+  res.corr.resize(N);
+
+  std::vector<const Series*> all(1, &x);
+  all.insert(all.end(), ys.begin(), ys.end());
+  for (auto row = AlignedMergeIterator<Series>::from_series_ptrs(all);
+       row; ++row) {
+    const auto& values = row.values();
+    if (row.present(0)) {
+      for (auto& a: aggx) a(values[0]);
+    }
+    for (auto i: row.present_series()) {
+      if (i == 0) continue;
+      auto k = i - 1;
+      aggy[k](values[i]);
+      if (!row.present(0)) continue;
+      auto vx = aggx[k].value();
+      auto vy = aggy[k].value();
+      aggx[k] = Agg();
+      aggy[k] = Agg();
+      if (impl::skip<AggResult>(vx) || impl::skip<AggResult>(vy)) continue;
+      auto& w = windows[k];
+      w(row.timestamp(), vx, vy);
+      if (w.ready()) {
+        res.beta[k].append(row.timestamp(), w.beta());
+        res.corr[k].append(row.timestamp(), w.corr());
+      }
+    }
+  }
+  return res;
+}
+
+} // namespace ts
+
+#endif /* ROLLING_BETA_HPP */
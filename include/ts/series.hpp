@@ -9,14 +9,157 @@
 #include <numeric>
 #include <sstream>
 #include <algorithm>
+#include <type_traits>
 
 #include <ts/exceptions.hpp>
 #include <ts/na.hpp>
 #include <ts/filters.hpp>
+#include <ts/parallel.hpp>
 
 
 namespace ts {
 
+namespace impl {
+
+/// Passes the values in [first, last) at once to the functors having
+/// a batch method process(const Value* first, const Value* last) skipping
+/// NAs.
+template<typename Functor, typename Value>
+auto process_batch(Functor& f, const Value* first, const Value* last, int)
+  -> decltype(f.process(first, last), bool())
+{
+  f.process(first, last);
+  return true;
+}
+
+/// Tells the caller to push the values one by one to the other functors.
+template<typename Functor, typename Value>
+bool process_batch(Functor&, const Value*, const Value*, long)
+{
+  return false;
+}
+
+/// Pushes the values in [first, last) to the functor skipping NAs.
+template<typename Functor, typename Value>
+void process_range(Functor& f, const Value* first, const Value* last)
+{
+  if (process_batch(f, first, last, 0)) return;
+  for (; first != last; ++first) {
+    if (na::can_na<Value>() && na::is_na(*first)) continue;
+    f(*first);
+  }
+}
+
+
+/// The first position in the sorted range [first, last) whose element is
+/// not less than value.
+///
+/// Probes the positions 1, 2, 4, ... from first before the binary search so
+/// it costs O(log d) where d is the distance to the result, which makes
+/// walking through a long range in short hops cheap.
+template<class Itr, class T>
+Itr gallop_lower_bound(Itr first, Itr last, const T& value)
+{
+  auto n = last - first;
+  if (n == 0 || !(*first < value)) return first;
+  decltype(n) lo = 0, hi = 1; // first[lo] < value
+  while (hi < n && first[hi] < value) {
+    lo = hi;
+    hi *= 2;
+  }
+  return std::lower_bound(first + lo + 1, first + std::min(hi, n), value);
+}
+
+/// The first position in the sorted range [first, last) whose element is
+/// greater than value. Gallops as gallop_lower_bound().
+template<class Itr, class T>
+Itr gallop_upper_bound(Itr first, Itr last, const T& value)
+{
+  auto n = last - first;
+  if (n == 0 || value < *first) return first;
+  decltype(n) lo = 0, hi = 1; // !(value < first[lo])
+  while (hi < n && !(value < first[hi])) {
+    lo = hi;
+    hi *= 2;
+  }
+  return std::upper_bound(first + lo + 1, first + std::min(hi, n), value);
+}
+
+/// The distance b - a >= 0 of integral timestamps as a double. The
+/// difference is taken in the unsigned type so it is exact (before the
+/// rounding to double) even for the nanosecond timestamps too close to
+/// each other to differ as doubles.
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, double>::type
+timestamp_distance(T a, T b)
+{
+  typedef typename std::make_unsigned<T>::type U;
+  return double(U(b) - U(a));
+}
+
+/// The distance b - a >= 0 of floating-point timestamps.
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value, double>::type
+timestamp_distance(T a, T b)
+{
+  return double(b) - double(a);
+}
+
+/// The first position in the sorted range [first, last) whose element is
+/// not less than value found by an interpolation search (arithmetic
+/// timestamps).
+///
+/// The position is guessed from the values at the ends of the range and
+/// the result is then galloped to from the guess, so the cost is O(log d)
+/// for a guess d positions off. For near-uniformly spaced timestamps this
+/// takes a few probes close to each other instead of the log2(n) dependent
+/// cache misses of a binary search and it is never worse than about twice
+/// the binary search.
+template<typename T>
+const T* timestamp_lower_bound(const T* first, const T* last, const T& value,
+                               std::true_type)
+{
+  size_t n = last - first;
+  if (n == 0 || !(first[0] < value)) return first;
+  if (first[n - 1] < value) return last;
+  double frac = timestamp_distance(first[0], value)
+                / timestamp_distance(first[0], first[n - 1]);
+  // e.g. the infinite timestamps leave nothing to interpolate
+  if (!(frac >= 0 && frac <= 1)) return std::lower_bound(first, last, value);
+  size_t pos = std::min(size_t(frac * (n - 1)), n - 1);
+  if (first[pos] < value) {
+    return gallop_lower_bound(first + pos + 1, last, value);
+  }
+  // gallop back: the elements from hi are not less than value
+  size_t hi = pos, step = 1;
+  while (step <= pos && !(first[pos - step] < value)) {
+    hi = pos - step;
+    step *= 2;
+  }
+  size_t lo = step <= pos ? pos - step + 1 : 0;
+  return std::lower_bound(first + lo, first + hi, value);
+}
+
+/// The binary search for the other timestamps.
+template<typename T>
+const T* timestamp_lower_bound(const T* first, const T* last, const T& value,
+                               std::false_type)
+{
+  return std::lower_bound(first, last, value);
+}
+
+/// The first position in the sorted range [first, last) whose element is
+/// not less than value: std::lower_bound which uses an interpolation search
+/// for the arithmetic timestamps.
+template<typename T>
+const T* timestamp_lower_bound(const T* first, const T* last, const T& value)
+{
+  return timestamp_lower_bound(first, last, value, std::is_arithmetic<T>());
+}
+
+} // namespace impl
+
+
 /// Tuple of iterators with increment operations.
 template<typename Itr1, typename Itr2>
 struct IndexValueIter: public std::pair<Itr1, Itr2>
@@ -72,94 +215,76 @@ struct IndexValueIter: public std::pair<Itr1, Itr2>
 };
 
 
-/// A class for storing ordered time series data.
-///
-/// Optimal internal storage depends on the usage scenarios.
-/// I assumed that the time series objects will be mostly stored
-/// elsewhere in a sorted way (if the index goes from oldest to newest)
-/// or appended with new observations in real time.
-///
-/// Internally the index is stored as a sorted vector. To find the element
-/// by index the binary search is used.
-///
-template<typename Timestamp, typename Value=double>
-class Series{
- public: // declarations and consts
+template<typename Timestamp, typename Value> class SeriesView;
 
-  typedef Series<Timestamp, Value> this_type;
-  typedef Timestamp timestamp_type;
-  typedef Value value_type;
-  typedef typename std::vector<Timestamp> index_type;
-  typedef typename std::vector<Value> values_type;
-  typedef IndexValueIter<typename index_type::const_iterator,
-                         typename values_type::const_iterator>
-                         paired_iterator_type;
-
- private: // variables
-
-  index_type index;
-  values_type values;
-
- public: // methods
-
-  /// Creates an empty Series
-  Series(){};
-
-  /// Creates a Series from index and value vectors
-  Series(index_type index_, values_type values_):
-    index(std::forward<index_type>(index_)),
-    values(std::forward<values_type>(values_))
-  {
-    post_construction_checks();
-  }
+namespace impl {
 
-  /// Returns the length of the time series
-  size_t size() const { return index.size(); }
-
-  //auto begin() -> decltype(auto) const { return values.cbegin(); }; 
-  //auto end() -> decltype(auto) const { return values.cend(); }; 
-
-  /// Adds a new observation at the end. Throws a TsException
-  /// if the new observation's index precedes the last value of
-  /// the current index
-  void append(Timestamp ix, Value val);
+/// A non-owning read-only view of a contiguous array.
+template<typename T>
+class Span
+{
+ public:
+  typedef T value_type;
+  typedef const T* const_iterator;
+
+  Span(): data_(nullptr), size_(0) {}
+  Span(const T* data, size_t size): data_(data), size_(size) {}
+
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  const T& front() const { return data_[0]; }
+  const T& back() const { return data_[size_ - 1]; }
+
+ private:
+  const T* data_; ///< The first element
+  size_t size_;   ///< Number of elements
+};
 
-  /// Finds the value corresponding to a given index value
-  Value& at(Timestamp x);
 
-  /// Finds the value corresponding to a given index value
-  Value& operator[](Timestamp x){ return at(x); }
-
-  /// Compares first the index and then the values
-  bool operator==(const this_type& other) const;
+/// A contiguous part of a series: size timestamps and values.
+template<typename Timestamp, typename Value>
+struct Segment
+{
+  const Timestamp* index; ///< The first timestamp
+  const Value* values;    ///< The first value
+  size_t size;            ///< Number of observations
+};
 
-  /// Returns the read-only "view" of the index
-  const index_type& indexView() const { return index; }
 
-  /// Returns the read-only "view" of an index
-  const values_type& valuesView() const { return values; }
+/// The algorithms common to all the series whatever their storage:
+/// application of functors, moments and batches of lookups.
+///
+/// Derived is the series class (CRTP) which provides size(), n_segments()
+/// and segment(i), the latter giving the contiguous parts of the
+/// observations in order. The contiguous series have a single segment
+/// (see SeriesBase) while e.g. the chunked series have one per chunk.
+template<typename Derived, typename Timestamp, typename Value>
+class SegmentedBase
+{
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
 
-  /// Paired (index, value) iterators to the beginning
-  paired_iterator_type begin_paired() const
-  {
-    return paired_iterator_type(index.cbegin(), values.cbegin());
-  }
+ public:
 
-  /// Paired (index, value) iterators to the end
-  paired_iterator_type end_paired() const
-  {
-    return paired_iterator_type(index.cend(), values.cend());
-  }
-  
-  /// Convert to a human-readable string
-  std::string to_string(std::string sep=std::string(", ")) const;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
 
-  /// Apply a functor to values (NAs impossible).
+  /// Apply a functor to values (NAs impossible). The functors having
+  /// a batch method process(first, last) get the values of each segment
+  /// at once.
   template<typename Functor>
   typename std::enable_if<!na::can_na<Value>(), Functor&>::type
   apply_values(Functor& f) const
   {
-    for (auto v: valuesView()) { f(v); }
+    for (size_t s=0; s < derived().n_segments(); ++s) {
+      auto seg = derived().segment(s);
+      auto v = seg.values;
+      if (process_batch(f, v, v + seg.size, 0)) continue;
+      for (size_t i=0; i < seg.size; ++i) { f(v[i]); }
+    }
     return f;
   }
 
@@ -168,24 +293,34 @@ class Series{
   typename std::enable_if<!na::can_na<Value>(), Functor&>::type
   apply_pairs(Functor& f) const
   {
-    for (auto c = begin_paired(); c != end_paired(); ++c) {
-      f(c.index(), c.value());
+    for (size_t s=0; s < derived().n_segments(); ++s) {
+      auto seg = derived().segment(s);
+      for (size_t i=0; i < seg.size; ++i) {
+        f(seg.index[i], seg.values[i]);
+      }
     }
     return f;
   }
 
-  /// Apply a functor to values (NAs possible).
+  /// Apply a functor to values (NAs possible). When skipping NAs the
+  /// functors having a batch method process(first, last) get the values of
+  /// each segment at once.
   template<typename Functor>
   typename std::enable_if<na::can_na<Value>(), Functor&>::type
   apply_values(Functor& f, bool skip_na=true) const
   {
-    if (skip_na) {
-      for (auto v: valuesView()) {
-        if (na::is_na(v)) continue;
-        f(v);
+    for (size_t s=0; s < derived().n_segments(); ++s) {
+      auto seg = derived().segment(s);
+      auto v = seg.values;
+      if (skip_na && process_batch(f, v, v + seg.size, 0)) continue;
+      if (skip_na) {
+        for (size_t i=0; i < seg.size; ++i) {
+          if (na::is_na(v[i])) continue;
+          f(v[i]);
+        }
+      } else {
+        for (size_t i=0; i < seg.size; ++i) { f(v[i]); }
       }
-    } else {
-      for (auto v: valuesView()) { f(v); }
     }
     return f;
   }
@@ -195,20 +330,55 @@ class Series{
   typename std::enable_if<na::can_na<Value>(), Functor&>::type
   apply_pairs(Functor& f, bool skip_na=true) const
   {
-    if (skip_na) {
-      for (auto c = begin_paired(); c != end_paired(); ++c) {
-        if (na::is_na(c.value())) continue;
-        f(c.index(), c.value());
-      }
-    } else {
-      for (auto c = begin_paired(); c != end_paired(); ++c) {
-        f(c.index(), c.value());
+    for (size_t s=0; s < derived().n_segments(); ++s) {
+      auto seg = derived().segment(s);
+      for (size_t i=0; i < seg.size; ++i) {
+        if (skip_na && na::is_na(seg.values[i])) continue;
+        f(seg.index[i], seg.values[i]);
       }
     }
     return f;
   }
 
-  /// The mean of the series.
+  /// Apply a mergeable estimator (e.g. OnlineMean) to the values skipping
+  /// NAs using n_threads threads (0 means one per core).
+  ///
+  /// The values are split into contiguous ranges of observations (which
+  /// may span several segments), each range is processed by a copy of est
+  /// and the partial estimators are combined in order by their merge()
+  /// method. The estimator est should not have processed any values yet as
+  /// it serves as the prototype for all the ranges.
+  template<typename Estimator>
+  Estimator parallel_apply(const Estimator& est, size_t n_threads=0) const
+  {
+    // smaller ranges are not worth starting a thread
+    const size_t min_range_size = 1 << 16;
+    const size_t n = derived().size();
+    if (n_threads == 0) n_threads = default_n_threads();
+    size_t n_ranges = std::min(n_threads, n / min_range_size);
+    if (n_ranges == 0) n_ranges = 1;
+    // offsets[s] is the position of the first observation of the segment s
+    std::vector<size_t> offsets(1, 0);
+    for (size_t s=0; s < derived().n_segments(); ++s) {
+      offsets.push_back(offsets.back() + derived().segment(s).size);
+    }
+    std::vector<Estimator> partial(n_ranges, est);
+    parallel_for(n_ranges, n_threads, [&](size_t r) {
+      size_t lo = n * r / n_ranges, hi = n * (r + 1) / n_ranges;
+      size_t s = std::upper_bound(offsets.begin(), offsets.end(), lo)
+                 - offsets.begin() - 1;
+      for (; s + 1 < offsets.size() && offsets[s] < hi; ++s) {
+        auto v = derived().segment(s).values;
+        process_range(partial[r],
+                      v + (std::max(lo, offsets[s]) - offsets[s]),
+                      v + (std::min(hi, offsets[s + 1]) - offsets[s]));
+      }
+    });
+    for (size_t r=1; r < n_ranges; ++r) partial[0].merge(partial[r]);
+    return partial[0];
+  }
+
+  /// The mean of the series (computed by blocks, see OnlineMean::process).
   double mean() const
   {
     auto est = filters::OnlineMean();
@@ -216,7 +386,8 @@ class Series{
     return est.value();
   }
 
-  /// The variance using a one-pass algorithm.
+  /// The variance using a one-pass algorithm over blocks of values (see
+  /// OnlineVarUnknownMean::process).
   double var() const
   {
     auto est = filters::OnlineVarUnknownMean();
@@ -232,6 +403,238 @@ class Series{
     return est.value();
   }
 
+  /// The values at the sorted timestamps ts, each one found as by at().
+  ///
+  /// The search for each timestamp gallops from the result for the
+  /// previous one, so a batch of lookups walks the index once in order.
+  /// Throws an IndexNotSorted exception if ts is not sorted and an
+  /// IndexError if a timestamp follows the last one of the series.
+  std::vector<Value> at_many(const std::vector<Timestamp>& ts) const
+  {
+    std::vector<Value> res;
+    res.reserve(ts.size());
+    const size_t n_segments = derived().n_segments();
+    size_t s = 0;
+    Segment<Timestamp, Value> seg = {nullptr, nullptr, 0};
+    if (n_segments > 0) seg = derived().segment(0);
+    auto loc = seg.index;
+    for (size_t i=0; i < ts.size(); ++i) {
+      if (i > 0 && ts[i] < ts[i - 1]) {
+        throw IndexNotSorted("at_many(): the timestamps are not sorted.");
+      }
+      // skip the segments ending before ts[i]
+      while (s < n_segments
+             && (seg.size == 0 || seg.index[seg.size - 1] < ts[i])) {
+        if (++s < n_segments) seg = derived().segment(s);
+        loc = seg.index;
+      }
+      if (s == n_segments){
+        throw IndexError<Timestamp>(ts[i]);
+      }
+      loc = gallop_lower_bound(loc, seg.index + seg.size, ts[i]);
+      res.push_back(seg.values[loc - seg.index]);
+    }
+    return res;
+  }
+};
+
+
+/// The functionality common to the contiguous series and the series views:
+/// pointer-based paired iterators and slicing on top of the algorithms of
+/// SegmentedBase.
+///
+/// Derived is the series class (CRTP) which provides size(), index_data()
+/// and values_data(), the latter two pointing to contiguous arrays.
+template<typename Derived, typename Timestamp, typename Value>
+class SeriesBase: public SegmentedBase<Derived, Timestamp, Value>
+{
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+
+ public:
+
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef IndexValueIter<const Timestamp*, const Value*> paired_iterator_type;
+
+  /// Returns the length of the time series
+  size_t size() const { return derived().size(); }
+
+  /// The contiguous storage makes a single segment
+  size_t n_segments() const { return 1; }
+
+  /// All the observations
+  Segment<Timestamp, Value> segment(size_t) const
+  {
+    return {derived().index_data(), derived().values_data(), size()};
+  }
+
+  /// Paired (index, value) iterators to the beginning
+  paired_iterator_type begin_paired() const
+  {
+    return paired_iterator_type(derived().index_data(),
+                                derived().values_data());
+  }
+
+  /// Paired (index, value) iterators to the end
+  paired_iterator_type end_paired() const
+  {
+    return paired_iterator_type(derived().index_data() + size(),
+                                derived().values_data() + size());
+  }
+
+  /// The non-owning view of the observations with timestamps in [t0, t1)
+  /// found by a binary search. The view does not copy anything and is
+  /// valid as long as the underlying storage is not modified.
+  SeriesView<Timestamp, Value> slice(Timestamp t0, Timestamp t1) const
+  {
+    auto first = derived().index_data(), last = first + size();
+    auto from = std::lower_bound(first, last, t0);
+    auto to = std::lower_bound(from, last, t1);
+    return SeriesView<Timestamp, Value>(
+        from, derived().values_data() + (from - first), to - from
+    );
+  }
+
+  /// The non-owning view of all the observations
+  SeriesView<Timestamp, Value> view() const
+  {
+    return SeriesView<Timestamp, Value>(derived().index_data(),
+                                        derived().values_data(), size());
+  }
+};
+
+} // namespace impl
+
+
+/// The storage policy keeping the index and the values in two vectors.
+struct ContiguousStorage {};
+
+
+/// A class for storing ordered time series data.
+///
+/// Optimal internal storage depends on the usage scenarios.
+/// I assumed that the time series objects will be mostly stored
+/// elsewhere in a sorted way (if the index goes from oldest to newest)
+/// or appended with new observations in real time.
+///
+/// Internally the index is stored as a sorted vector. To find the element
+/// by index the binary search (or, for the arithmetic timestamps, the
+/// interpolation search) is used.
+///
+/// The Storage parameter selects the storage policy: ContiguousStorage
+/// (this class) or ChunkedStorage (see chunked_series.hpp).
+///
+template<typename Timestamp, typename Value=double,
+         typename Storage=ContiguousStorage>
+class Series: public impl::SeriesBase<Series<Timestamp, Value, Storage>,
+                                      Timestamp, Value>
+{
+  static_assert(std::is_same<Storage, ContiguousStorage>::value,
+                "Series: unknown storage policy (is chunked_series.hpp "
+                "included?)");
+
+ public: // declarations and consts
+
+  typedef Series<Timestamp, Value, Storage> this_type;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef typename std::vector<Timestamp> index_type;
+  typedef typename std::vector<Value> values_type;
+  typedef IndexValueIter<const Timestamp*, const Value*> paired_iterator_type;
+
+ private: // variables
+
+  index_type index;
+  values_type values;
+
+ public: // methods
+
+  /// Creates an empty Series
+  Series(){};
+
+  /// Creates a Series from index and value vectors
+  Series(index_type index_, values_type values_):
+    index(std::forward<index_type>(index_)),
+    values(std::forward<values_type>(values_))
+  {
+    post_construction_checks();
+  }
+
+  /// Creates a Series from index and value vectors already known to be
+  /// sorted (e.g. checked while parsing) skipping the scan of the index.
+  static this_type from_sorted(index_type index_, values_type values_)
+  {
+    if (index_.size() != values_.size()) {
+      throw SizeError("The index and the values must be of the same size.");
+    }
+    this_type res;
+    res.index = std::move(index_);
+    res.values = std::move(values_);
+    return res;
+  }
+
+  /// Returns the length of the time series
+  size_t size() const { return index.size(); }
+
+  //auto begin() -> decltype(auto) const { return values.cbegin(); }; 
+  //auto end() -> decltype(auto) const { return values.cend(); }; 
+
+  /// Adds a new observation at the end. Throws a TsException
+  /// if the new observation's index precedes the last value of
+  /// the current index
+  void append(Timestamp ix, Value val);
+
+  /// Adds n observations at the end. Throws an IndexNotSorted exception
+  /// (and adds nothing) unless the timestamps of the block are strictly
+  /// increasing and follow the last timestamp of the series, like those
+  /// appended one by one.
+  void append_bulk(const Timestamp* ix, const Value* vals, size_t n);
+
+  /// Adds a new observation at the end without checking the timestamp.
+  /// For the trusted sources which guarantee the order.
+  void append_unchecked(Timestamp ix, Value val)
+  {
+    index.push_back(ix);
+    values.push_back(val);
+  }
+
+  /// Allocates the storage for n observations
+  void reserve(size_t n)
+  {
+    index.reserve(n);
+    values.reserve(n);
+  }
+
+  /// Number of observations which fit in the allocated storage
+  size_t capacity() const
+  {
+    return std::min(index.capacity(), values.capacity());
+  }
+
+  /// Finds the value corresponding to a given index value
+  Value& at(Timestamp x);
+
+  /// Finds the value corresponding to a given index value
+  Value& operator[](Timestamp x){ return at(x); }
+
+  /// Compares first the index and then the values
+  bool operator==(const this_type& other) const;
+
+  /// Returns the read-only "view" of the index
+  const index_type& indexView() const { return index; }
+
+  /// Returns the read-only "view" of an index
+  const values_type& valuesView() const { return values; }
+
+  /// The index as a contiguous array
+  const Timestamp* index_data() const { return index.data(); }
+
+  /// The values as a contiguous array
+  const Value* values_data() const { return values.data(); }
+
+  /// Convert to a human-readable string
+  std::string to_string(std::string sep=std::string(", ")) const;
+
 private: // methods
 
   /// Checks if the index is sorted and has the same size as the values.
@@ -243,8 +646,8 @@ private: // methods
 // Implementation of longer methods
 //
 
-template<typename Timestamp, typename Value>
-void Series<Timestamp, Value>::post_construction_checks()
+template<typename Timestamp, typename Value, typename Storage>
+void Series<Timestamp, Value, Storage>::post_construction_checks()
 {
   if (index.size() != values.size()) {
     throw SizeError("The index and the values must be of the same size.");
@@ -254,8 +657,8 @@ void Series<Timestamp, Value>::post_construction_checks()
   };
 }
 
-template<typename Timestamp, typename Value>
-void Series<Timestamp, Value>::append(Timestamp ix, Value val)
+template<typename Timestamp, typename Value, typename Storage>
+void Series<Timestamp, Value, Storage>::append(Timestamp ix, Value val)
 {
   if (index.size() > 0 && ix <= index.back()) {
     throw IndexNotSorted(
@@ -266,12 +669,30 @@ void Series<Timestamp, Value>::append(Timestamp ix, Value val)
   values.push_back(val);
 }
 
-template<typename Timestamp, typename Value>
-Value& Series<Timestamp, Value>::at(Timestamp x)
+template<typename Timestamp, typename Value, typename Storage>
+void Series<Timestamp, Value, Storage>::append_bulk(const Timestamp* ix,
+                                                    const Value* vals,
+                                                    size_t n)
 {
-  auto begin = index.cbegin();
-  auto end = index.cend();
-  auto loc = std::lower_bound(begin, end, x);
+  if (n == 0) return;
+  // one branchless pass over the block which the compiler can vectorize
+  bool increasing = index.empty() || index.back() < ix[0];
+  for (size_t i=1; i < n; ++i) increasing &= ix[i - 1] < ix[i];
+  if (!increasing) {
+    throw IndexNotSorted(
+      "Appending a block of timestamps which are not increasing."
+    );
+  }
+  index.insert(index.end(), ix, ix + n);
+  values.insert(values.end(), vals, vals + n);
+}
+
+template<typename Timestamp, typename Value, typename Storage>
+Value& Series<Timestamp, Value, Storage>::at(Timestamp x)
+{
+  auto begin = index.data();
+  auto end = begin + index.size();
+  auto loc = impl::timestamp_lower_bound(begin, end, x);
   if (loc == end){
     throw IndexError<Timestamp>(x);
   }
@@ -279,15 +700,17 @@ Value& Series<Timestamp, Value>::at(Timestamp x)
 }
 
 // Equality comparison operators
-template<typename Timestamp, typename Value>
-bool Series<Timestamp, Value>::operator==(const this_type& other) const
+template<typename Timestamp, typename Value, typename Storage>
+bool Series<Timestamp, Value, Storage>::operator==(
+    const this_type& other) const
 {
   return (indexView() == other.indexView()
           && valuesView() == other.valuesView());
 }
 
-template<typename Timestamp, typename Value>
-std::string Series<Timestamp, Value>::to_string(std::string sep) const
+template<typename Timestamp, typename Value, typename Storage>
+std::string Series<Timestamp, Value, Storage>::to_string(
+    std::string sep) const
 {
   std::ostringstream out;
   for (size_t i=0; i < size(); ++i)
@@ -297,6 +720,88 @@ std::string Series<Timestamp, Value>::to_string(std::string sep) const
   return out.str();
 }
 
+
+/// A non-owning read-only view of a part of a series (or of any sorted
+/// contiguous index and values), e.g. a time range taken by slice().
+///
+/// The view copies nothing and supports the same application of functors,
+/// moments, paired iteration and merging as the Series; it is valid as long
+/// as the underlying storage is not modified.
+template<typename Timestamp, typename Value=double>
+class SeriesView: public impl::SeriesBase<SeriesView<Timestamp, Value>,
+                                          Timestamp, Value>
+{
+ public:
+
+  typedef SeriesView<Timestamp, Value> this_type;
+  typedef Timestamp timestamp_type;
+  typedef Value value_type;
+  typedef impl::Span<Timestamp> index_type;
+  typedef impl::Span<Value> values_type;
+  typedef IndexValueIter<const Timestamp*, const Value*> paired_iterator_type;
+
+  /// Creates an empty view
+  SeriesView(): index_(), values_() {}
+
+  /// Creates a view of size observations from a sorted index and values
+  SeriesView(const Timestamp* index, const Value* values, size_t size)
+    : index_(index, size),
+      values_(values, size)
+  {}
+
+  /// Returns the length of the view
+  size_t size() const { return index_.size(); }
+
+  /// Returns the read-only view of the index
+  const index_type& indexView() const { return index_; }
+
+  /// Returns the read-only view of the values
+  const values_type& valuesView() const { return values_; }
+
+  /// The index as a contiguous array
+  const Timestamp* index_data() const { return index_.data(); }
+
+  /// The values as a contiguous array
+  const Value* values_data() const { return values_.data(); }
+
+  /// Finds the value corresponding to a given index value
+  const Value& at(Timestamp x) const
+  {
+    auto loc = impl::timestamp_lower_bound(index_.begin(), index_.end(), x);
+    if (loc == index_.end()){
+      throw IndexError<Timestamp>(x);
+    }
+    return values_[loc - index_.begin()];
+  }
+
+  /// Finds the value corresponding to a given index value
+  const Value& operator[](Timestamp x) const { return at(x); }
+
+  /// Copies the observations to a new series
+  Series<Timestamp, Value> to_series() const
+  {
+    return Series<Timestamp, Value>(
+        std::vector<Timestamp>(index_.begin(), index_.end()),
+        std::vector<Value>(values_.begin(), values_.end())
+    );
+  }
+
+  /// Convert to a human-readable string
+  std::string to_string(std::string sep=std::string(", ")) const
+  {
+    std::ostringstream out;
+    for (size_t i=0; i < size(); ++i)
+    {
+      out << index_[i] << ":" << values_[i] << sep;
+    }
+    return out.str();
+  }
+
+ private:
+  index_type index_;   ///< The index
+  values_type values_; ///< The values
+};
+
 } // namespace ts
 
 #define SERIES_HPP
@@ -4,10 +4,16 @@
 #define TS_HPP 
 
 #include <ts/series.hpp> 
+#include <ts/chunked_series.hpp> 
+#include <ts/ring_series.hpp> 
 #include <ts/accumulator.hpp> 
 #include <ts/aggregators.hpp> 
 #include <ts/exceptions.hpp> 
 #include <ts/covariance.hpp> 
+#include <ts/join.hpp> 
+#include <ts/reader.hpp> 
+#include <ts/resample.hpp> 
+#include <ts/rolling_beta.hpp> 
 #include <ts/na.hpp> 
 
 #include <ts/filters.hpp> 
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 
 #include <ts/ts.hpp>
 #include <ts/printing.hpp>
@@ -91,6 +92,393 @@ class RollingTest
 };
 
 
+// Brute force median of the last width values ending at position end
+double median_of_window(const std::vector<double>& xs, size_t end, size_t width)
+{
+  std::vector<double> w(xs.begin() + end + 1 - width, xs.begin() + end + 1);
+  std::sort(w.begin(), w.end());
+  return (w[(width - 1) / 2] + w[width / 2]) / 2.0;
+}
+
+
+// Compare the rolling median on pseudo-random input with duplicates
+// against sorting every window.
+void test_median_random(size_t width)
+{
+  std::srand(42);
+  std::vector<double> xs;
+  for (int i=0; i < 500; ++i) xs.push_back(std::rand() % 50);
+  RollingMedian<double> rm(width);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    rm(xs[i]);
+    if (i + 1 < width) {
+      ok = ok && !rm.ready();
+    } else {
+      ok = ok && rm.value() == median_of_window(xs, i, width);
+    }
+  }
+  Assert::is_true(ok, "rolling median differs from brute force", __func__);
+}
+
+
+// Brute force linearly interpolated quantile of a sorted window
+double quantile_of_sorted(const std::vector<double>& w, double p)
+{
+  double h = (w.size() - 1) * p;
+  size_t k = std::floor(h);
+  if (k + 1 >= w.size()) return w[k];
+  return w[k] + (h - k) * (w[k + 1] - w[k]);
+}
+
+
+// Compare the rolling quantiles, min, max and MAD on pseudo-random input
+// with duplicates against sorting every window.
+void test_quantiles_random(size_t width)
+{
+  std::srand(7);
+  std::vector<double> xs;
+  for (int i=0; i < 500; ++i) xs.push_back(std::rand() % 30);
+  std::vector<double> probs = {0.05, 0.5, 0.95};
+  RollingQuantiles<double> rq(width, probs);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    rq(xs[i]);
+    if (i + 1 < width) {
+      ok = ok && !rq.ready() && na::is_na(rq.value()[0]);
+      continue;
+    }
+    std::vector<double> w(xs.begin() + i + 1 - width, xs.begin() + i + 1);
+    std::sort(w.begin(), w.end());
+    auto qs = rq.value();
+    for (size_t j=0; j < probs.size(); ++j) {
+      ok = ok && std::abs(qs[j] - quantile_of_sorted(w, probs[j])) < 1e-9;
+    }
+    ok = ok && rq.median() == median_of_window(xs, i, width);
+    ok = ok && rq.min() == w.front() && rq.max() == w.back();
+    // median of the absolute deviations
+    std::vector<double> dev;
+    for (auto x: w) dev.push_back(std::abs(x - rq.median()));
+    std::sort(dev.begin(), dev.end());
+    ok = ok && std::abs(rq.mad() - quantile_of_sorted(dev, 0.5)) < 1e-9;
+  }
+  Assert::is_true(ok, "rolling quantiles differ from brute force", __func__);
+}
+
+
+// The quantiles can be accumulated in a series of vectors
+void test_quantiles_accumulator()
+{
+  auto s = AutoIndex<int>(1).zipValues(Sequence<double>(1, 1).take(5));
+  auto rq = RollingQuantiles<double>(3, {0, 1});
+  auto acc = Accumulator<RollingQuantiles<double>, int>(rq);
+  auto out = s.apply_pairs(acc).value();
+  bool ok = out.size() == 3 && out.indexView().front() == 3;
+  for (size_t i=0; ok && i < out.size(); ++i) {
+    ok = out.valuesView()[i] == std::vector<double>({i + 1.0, i + 3.0});
+  }
+  Assert::is_true(ok, "wrong accumulated quantiles", __func__);
+}
+
+
+// The quantiles of the integers (no NA) are T() until the filter is ready
+void test_quantiles_int()
+{
+  auto rq = RollingQuantiles<int>(3, {0, 0.5, 1});
+  rq(4);
+  rq(1);
+  bool ok = !rq.ready() && rq.value() == std::vector<int>({0, 0, 0});
+  ok = ok && rq(7) == std::vector<int>({1, 4, 7});
+  ok = ok && rq(3) == std::vector<int>({1, 3, 7});
+  Assert::is_true(ok, "wrong integer quantiles", __func__);
+}
+
+
+// Compare the rolling min, max and range against scanning every window.
+void test_extremum_random(size_t width)
+{
+  std::srand(3);
+  std::vector<double> xs;
+  for (int i=0; i < 500; ++i) xs.push_back(std::rand() % 100);
+  RollingMin<double> rmin(width);
+  RollingMax<double> rmax(width);
+  RollingRange<double> rrange(width);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    rmin(xs[i]);
+    rmax(xs[i]);
+    rrange(xs[i]);
+    if (i + 1 < width) {
+      ok = ok && !rmin.ready() && !rmax.ready() && !rrange.ready();
+      continue;
+    }
+    auto first = xs.begin() + i + 1 - width, last = xs.begin() + i + 1;
+    auto lo = *std::min_element(first, last);
+    auto hi = *std::max_element(first, last);
+    ok = ok && rmin.value() == lo && rmax.value() == hi
+            && rrange.value() == hi - lo;
+  }
+  Assert::is_true(ok, "rolling extremum differs from brute force", __func__);
+}
+
+
+// The integral extrema (no NA) are T() until the filter is ready and can be
+// accumulated
+void test_extremum_int()
+{
+  RollingMin<int> rmin(2);
+  RollingRange<int> rrange(2);
+  bool ok = rmin(5) == 0 && rrange(5) == 0 && !rmin.ready();
+  ok = ok && rmin(3) == 3 && rrange(3) == 2;
+  auto s = Series<int, int>({1, 2, 3, 4}, {4, 9, 1, 6});
+  auto acc = Accumulator<RollingMax<int>, int>(RollingMax<int>(2));
+  ok = ok && s.apply_pairs(acc).value()
+             == Series<int, int>({2, 3, 4}, {9, 9, 6});
+  Assert::is_true(ok, "wrong integer extrema", __func__);
+}
+
+
+// Compare the time-windowed mean and median on an irregular index
+// against scanning the window (t - length, t].
+void test_time_window_random(int length)
+{
+  std::srand(11);
+  std::vector<int> index;
+  std::vector<double> xs;
+  int t = 0;
+  for (int i=0; i < 400; ++i) {
+    t += std::rand() % 4; // repeated timestamps are allowed here
+    index.push_back(t);
+    xs.push_back(std::rand() % 20);
+  }
+  TimeRollingMean<int> mean(length);
+  TimeRollingMedian<int> median(length);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    mean(index[i], xs[i]);
+    median(index[i], xs[i]);
+    if (index[i] < index[0] + length) {
+      ok = ok && !mean.ready() && !median.ready();
+      continue;
+    }
+    std::vector<double> w;
+    for (size_t j=0; j <= i; ++j) {
+      if (index[j] > index[i] - length) w.push_back(xs[j]);
+    }
+    std::sort(w.begin(), w.end());
+    double sum = std::accumulate(w.begin(), w.end(), 0.0);
+    ok = ok && mean.count() == w.size()
+            && std::abs(mean.value() - sum / w.size()) < 1e-9
+            && median.value() == quantile_of_sorted(w, 0.5);
+  }
+  Assert::is_true(ok, "time-windowed filters differ from brute force",
+                  __func__);
+  TimeRollingMedian<int, int> imedian(2);
+  ok = na::is_na(imedian(0, 1));
+  imedian(1, 2);
+  ok = ok && imedian(2, 4) == 3.0 && imedian(3, 2147483647) == 1073741825.5;
+  Assert::is_true(ok, "wrong median of integers", __func__);
+}
+
+
+// The accumulator passes the timestamps to the time-windowed filters
+void test_time_window_accumulator()
+{
+  auto s = Series<int, double>({0, 1, 5, 6, 7}, {1, 2, 3, 4, 5});
+  auto acc = Accumulator<TimeRollingMean<int>, int>(TimeRollingMean<int>(3));
+  auto out = s.apply_pairs(acc).value();
+  Assert::is_true(
+      out == Series<int, double>({5, 6, 7}, {3, 3.5, 4}),
+      "wrong accumulated time-windowed means",
+      __func__
+  );
+}
+
+
+// Compare the time-windowed covariance against the two-pass formulas
+void test_time_cov_random(int length)
+{
+  std::srand(12);
+  std::vector<int> index;
+  std::vector<double> xs, ys;
+  int t = 0;
+  for (int i=0; i < 400; ++i) {
+    t += std::rand() % 4;
+    index.push_back(t);
+    xs.push_back(1e3 + std::rand() % 20);
+    ys.push_back(xs.back() / 2 + std::rand() % 10);
+  }
+  TimeRollingCov<int> cov(length);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    cov(index[i], xs[i], ys[i]);
+    if (index[i] < index[0] + length) {
+      ok = ok && !cov.ready();
+      continue;
+    }
+    double sx = 0, sy = 0, n = 0;
+    for (size_t j=0; j <= i; ++j) {
+      if (index[j] <= index[i] - length) continue;
+      sx += xs[j];
+      sy += ys[j];
+      ++n;
+    }
+    double cxx = 0, cxy = 0;
+    for (size_t j=0; j <= i; ++j) {
+      if (index[j] <= index[i] - length) continue;
+      cxx += (xs[j] - sx / n) * (xs[j] - sx / n);
+      cxy += (xs[j] - sx / n) * (ys[j] - sy / n);
+    }
+    ok = ok && cov.count() == n;
+    if (n > 1) {
+      ok = ok && std::abs(cov.value() - cxy / (n - 1)) < 1e-6
+              && (cxx == 0 || std::abs(cov.beta() - cxy / cxx) < 1e-6);
+    }
+  }
+  Assert::is_true(ok, "time-windowed covariance differs from brute force",
+                  __func__);
+}
+
+
+// Compare the rolling variance and covariance on a long input with a large
+// offset against the two-pass formulas on every window.
+void test_moments_random(size_t width)
+{
+  std::srand(5);
+  std::vector<double> xs, ys;
+  for (int i=0; i < 3000; ++i) {
+    xs.push_back(1e6 + (std::rand() % 1000) / 7.0);
+    ys.push_back(-xs.back() / 3 + (std::rand() % 100) / 11.0);
+  }
+  RollingVar var(width);
+  RollingStd std_(width);
+  RollingCov cov(width);
+  RollingCorr corr(width);
+  bool ok = true;
+  for (size_t i=0; i < xs.size(); ++i) {
+    var(xs[i]);
+    std_(xs[i]);
+    cov(xs[i], ys[i]);
+    corr(std::make_pair(xs[i], ys[i]));
+    if (i + 1 < width) {
+      ok = ok && !var.ready() && !cov.ready() && na::is_na(corr.value());
+      continue;
+    }
+    double mx = 0, my = 0, cxx = 0, cyy = 0, cxy = 0;
+    for (size_t j=i + 1 - width; j <= i; ++j) { mx += xs[j]; my += ys[j]; }
+    mx /= width;
+    my /= width;
+    for (size_t j=i + 1 - width; j <= i; ++j) {
+      cxx += (xs[j] - mx) * (xs[j] - mx);
+      cyy += (ys[j] - my) * (ys[j] - my);
+      cxy += (xs[j] - mx) * (ys[j] - my);
+    }
+    auto close = [](double a, double b) {
+      return std::abs(a - b) <= 1e-6 * (std::abs(b) + 1);
+    };
+    ok = ok && close(var.value(), cxx / (width - 1))
+            && close(std_.value(), std::sqrt(cxx / (width - 1)))
+            && close(cov.value(), cxy / (width - 1))
+            && (cxx * cyy == 0
+                || close(corr.value(), cxy / std::sqrt(cxx * cyy)));
+  }
+  Assert::is_true(ok, "rolling moments differ from the two-pass formulas",
+                  __func__);
+}
+
+
+// The rolling mean should not drift from the mean recomputed from scratch
+// after millions of updates with changing levels.
+void test_mean_drift()
+{
+  const size_t width = 1000;
+  std::srand(1);
+  std::vector<double> xs;
+  for (long i=0; i < 3000000; ++i) {
+    xs.push_back(1e6 * ((i / 100000) % 3) + (std::rand() % 100000) / 7.0);
+  }
+  RollingMean rm(width);
+  for (auto x: xs) rm(x);
+  double expected = std::accumulate(xs.end() - width, xs.end(), 0.0) / width;
+  Assert::almost_equal(rm.value(), expected, "rolling mean drifted",
+                       __func__, 1e-15 * expected);
+}
+
+
+// Before the window is full the rolling mean returns the partial sum
+// divided by the window size while value() is NA
+void test_mean_not_ready()
+{
+  RollingMean rm(4);
+  bool ok = rm(2) == 0.5 && rm(6) == 2 && na::is_na(rm.value());
+  ok = ok && rm(1) == 2.25 && rm(3) == 3 && rm.value() == 3;
+  Assert::is_true(ok, "wrong output before the window is full", __func__);
+}
+
+
+// Exponentially weighted filters with a constant weight per observation
+void test_ewm_alpha()
+{
+  std::vector<double> xs = {1, 3, na::na<double>(), 2, 6};
+  EwmMean<> mean(0.5);
+  EwmVar<> var(0.5);
+  EwmCov<> cov(0.5);
+  bool ok = !mean.ready();
+  for (auto x: xs) {
+    mean(x);
+    var(x);
+    cov(x, 2 * x);
+  }
+  // mean: 1 -> 2 -> 2 -> 4; var: 0 -> 1 -> 0.5 -> 0.5 * (0.5 + 4 * 2)
+  ok = ok && mean.n_processed() == 4 && mean.value() == 4;
+  ok = ok && std::abs(var.value() - 4.25) < 1e-12;
+  ok = ok && std::abs(cov.value() - 2 * var.value()) < 1e-12
+          && std::abs(cov.corr() - 1) < 1e-12;
+  Assert::is_true(ok, "wrong exponentially weighted estimates", __func__);
+}
+
+
+// Exponentially weighted mean decaying with time: an observation one
+// half-life after the previous one gets the weight 1/2
+void test_ewm_halflife()
+{
+  auto s = Series<int, double>({0, 10, 20, 50}, {0, 8, na::na<double>(), 20});
+  auto acc = Accumulator<EwmMean<int>, int>(EwmMean<int>::from_halflife(10));
+  auto out = s.apply_pairs(acc, false).value();
+  // 0 -> 0 + 1/2 * 8 = 4 -> (NA skipped) -> 4 + (1 - 1/16) * (20 - 4) = 19
+  Assert::is_true(
+      out == Series<int, double>({0, 10, 20, 50}, {0, 4, 4, 19}),
+      "wrong time-decayed mean",
+      __func__
+  );
+}
+
+
+// Exponentially weighted estimates with several observations at the same
+// timestamp: those get equal weights instead of being dropped
+void test_ewm_same_timestamp()
+{
+  auto mean = EwmMean<int>::from_halflife(10);
+  auto var = EwmVar<int>::from_halflife(10);
+  std::vector<std::pair<int, double> > ticks = {{0, 0}, {10, 8}, {10, 2}};
+  for (auto& t: ticks) {
+    mean(t.first, t.second);
+    var(t.first, t.second);
+  }
+  // the weights of 0, 8 and 2 are equal: 0 -> (1/2, 1/2) -> (1/3, 1/3, 1/3)
+  bool ok = std::abs(mean.value() - 10 / 3.0) < 1e-12;
+  ok = ok && std::abs(var.mean() - 10 / 3.0) < 1e-12
+          && std::abs(var.value() - 104 / 9.0) < 1e-12;
+  // the order of the burst does not matter for the mean
+  auto mean2 = EwmMean<int>::from_halflife(10);
+  mean2(0, 0);
+  mean2(10, 2);
+  mean2(10, 8);
+  ok = ok && std::abs(mean2.value() - mean.value()) < 1e-12;
+  Assert::is_true(ok, "wrong weights at the same timestamp", __func__);
+}
+
+
 int main()
 {
   //test_rolling_mean_5();
@@ -102,6 +490,37 @@ int main()
   RollingTest rt2(4, 10);
   rt1.test_mean();
   rt2.test_median();
+
+  test_median_random(2);
+  test_median_random(7);
+  test_median_random(64);
+
+  test_quantiles_random(1);
+  test_quantiles_random(6);
+  test_quantiles_random(41);
+  test_quantiles_accumulator();
+  test_quantiles_int();
+
+  test_extremum_random(1);
+  test_extremum_random(5);
+  test_extremum_random(33);
+  test_extremum_int();
+
+  test_time_window_random(1);
+  test_time_window_random(10);
+  test_time_window_accumulator();
+  test_time_cov_random(1);
+  test_time_cov_random(15);
+
+  test_moments_random(2);
+  test_moments_random(50);
+
+  test_mean_drift();
+  test_mean_not_ready();
+
+  test_ewm_alpha();
+  test_ewm_halflife();
+  test_ewm_same_timestamp();
   
   std::cout << std::endl;
   std::cout << "-- The demo of the median algorithm --" << std::endl;
@@ -17,12 +17,19 @@
 //    scalars and vectors
 // 3) Lack of automatic test detection
 
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 
 #include <ts/ts.hpp>
+#include <ts/merge.hpp>
+#include <ts/mapped.hpp>
+#include <ts/reader.hpp>
+#include <ts/chunked_series.hpp>
+#include <ts/ring_series.hpp>
 
 #include "testutils.hpp"
 
@@ -189,6 +196,825 @@ void test_cov_estimated_means()
 }
 
 
+// Test that the blockwise mean() and var() agree with pushing the values
+// one by one on an input spanning several blocks and containing NAs
+void test_mean_var_blocks()
+{
+  std::vector<int> index;
+  std::vector<double> values;
+  std::srand(1);
+  for (int i=0; i < 5000; ++i) {
+    index.push_back(i);
+    values.push_back(i % 97 == 0 ? na::na<double>() : std::rand() % 1000);
+  }
+  Series<int, double> s(index, values);
+  filters::OnlineVarUnknownMean est;
+  for (auto v: values) {
+    if (!na::is_na(v)) est(v);
+  }
+  Assert::almost_equal(s.mean(), est.mean(), "wrong mean", __func__, 1e-9);
+  Assert::almost_equal(s.var(), est.value(), "wrong var", __func__, 1e-6);
+}
+
+
+// The blocks of a long batch (an odd number of them with a partial last
+// one) are merged as a tree; the result agrees with the two-pass moments
+void test_block_moments()
+{
+  std::srand(4);
+  std::vector<double> xs(7 * 1024 + 5);
+  for (auto& x: xs) x = 1e6 + (std::rand() % 1000) / 3.0;
+  double mean = std::accumulate(xs.begin(), xs.end(), 0.0) / xs.size();
+  double ss = 0;
+  for (auto x: xs) ss += (x - mean) * (x - mean);
+  filters::OnlineVarUnknownMean est;
+  est.process(xs.data(), xs.data() + xs.size());
+  Assert::almost_equal(est.mean(), mean, "wrong mean", __func__, 1e-7);
+  Assert::almost_equal(est.value(), ss / (xs.size() - 1), "wrong var",
+                       __func__, 1e-6);
+}
+
+
+void test_merge_estimators()
+{
+  std::srand(2);
+  filters::OnlineMean mean_all, mean_a, mean_b;
+  filters::OnlineVarUnknownMean var_all, var_a, var_b;
+  filters::OnlineCovUnknownMeans cov_all, cov_a, cov_b;
+  for (int i=0; i < 1000; ++i) {
+    double x = std::rand() % 1000, y = x / 2 + std::rand() % 100;
+    mean_all(x);
+    var_all(x);
+    cov_all(x, y);
+    if (i < 300) {
+      mean_a(x);
+      var_a(x);
+      cov_a(x, y);
+    } else {
+      mean_b(x);
+      var_b(x);
+      cov_b(x, y);
+    }
+  }
+  mean_a.merge(mean_b);
+  var_a.merge(var_b);
+  cov_a.merge(cov_b);
+  Assert::almost_equal(mean_a.value(), mean_all.value(), "wrong mean",
+                       __func__, 1e-9);
+  Assert::almost_equal(var_a.value(), var_all.value(), "wrong var",
+                       __func__, 1e-6);
+  Assert::almost_equal(cov_a.cov(), cov_all.cov(), "wrong cov",
+                       __func__, 1e-6);
+}
+
+
+void test_parallel_apply()
+{
+  std::vector<int> index;
+  std::vector<double> values;
+  std::srand(3);
+  for (int i=0; i < 300000; ++i) {
+    index.push_back(i);
+    values.push_back(i % 101 == 0 ? na::na<double>() : std::rand() % 1000);
+  }
+  Series<int, double> s(index, values);
+  auto mean = s.parallel_apply(filters::OnlineMean(), 4);
+  auto var = s.parallel_apply(filters::OnlineVarUnknownMean(), 4);
+  Assert::almost_equal(mean.value(), s.mean(), "wrong mean", __func__, 1e-9);
+  Assert::almost_equal(var.value(), s.var(), "wrong var", __func__, 1e-6);
+}
+
+
+void test_apply_each_parallel()
+{
+  std::vector<Series<int, double> > series(50);
+  std::srand(4);
+  for (size_t k=0; k < series.size(); ++k) {
+    for (int i=0; i < int(10 * k); ++i) {
+      series[k].append(i, i % 7 == 0 ? na::na<double>() : std::rand() % 100);
+    }
+  }
+  std::vector<const Series<int, double>*> ptrs;
+  for (auto& s: series) ptrs.push_back(&s);
+  auto factory = []() {
+    return Accumulator<filters::RollingMean, int>(filters::RollingMean(5));
+  };
+  auto results = apply_each_parallel(ptrs, factory, 4);
+  bool ok = results.size() == series.size();
+  for (size_t k=0; ok && k < series.size(); ++k) {
+    auto acc = factory();
+    auto expected = series[k].apply_pairs(acc).value();
+    ok = results[k].size() == expected.size();
+    for (size_t i=0; ok && i < expected.size(); ++i) {
+      ok = results[k].indexView()[i] == expected.indexView()[i]
+        && results[k].valuesView()[i] == expected.valuesView()[i];
+    }
+  }
+  Assert::is_true(ok, "results differ from the serial ones", __func__);
+}
+
+
+void test_merge_iterator()
+{
+  std::vector<Series<int, int> > series(40);
+  std::srand(5);
+  std::vector<std::pair<int, int> > expected; // (timestamp, series)
+  for (size_t k=0; k < series.size(); ++k) {
+    int t = std::rand() % 10;
+    for (size_t i=0; i < k % 7; ++i) {
+      series[k].append(t, k);
+      expected.push_back(std::make_pair(t, k));
+      t += 1 + std::rand() % 5;
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+  SeriesCollection<Series<int, int> > coll;
+  for (auto& s: series) coll.push_back(&s);
+  std::vector<std::pair<int, int> > merged;
+  for (auto it = coll.merge_iterator(); it; ++it) {
+    merged.push_back(std::make_pair(it.timestamp(), it.series()));
+    if (it.value() != it.series()) merged.clear();
+  }
+  Assert::is_true(merged == expected, "wrong order of the observations",
+                  __func__);
+}
+
+
+void test_aligned_merge_iterator()
+{
+  Series<int, int> x({1, 2, 4}, {10, 20, 40});
+  Series<int, int> y({2, 3, 4}, {21, 31, 41});
+  Series<int, int> z;
+  SeriesCollection<Series<int, int> > coll({&x, &y, &z});
+  std::vector<int> timestamps, rows;
+  for (auto it = coll.aligned_merge_iterator(); it; ++it) {
+    timestamps.push_back(it.timestamp());
+    int row = 0; // the present values as digits
+    for (size_t i=0; i < it.n_series(); ++i) {
+      row = 100 * row + (it.present(i) ? it.values()[i] : 0);
+    }
+    rows.push_back(row);
+  }
+  Assert::is_true(timestamps == std::vector<int>({1, 2, 3, 4}),
+                  "wrong timestamps", __func__);
+  Assert::is_true(rows == std::vector<int>({100000, 202100, 3100, 404100}),
+                  "wrong rows", __func__);
+}
+
+
+void test_asof_join()
+{
+  Series<int, int> trades({0, 3, 5, 5, 9, 20}, {1, 2, 3, 4, 5, 6});
+  Series<int, double> quotes({1, 2, 3, 7, 8, 9, 10},
+                             {10, 20, 30, 70, 80, 90, 100});
+  auto joined = asof_join(trades, quotes);
+  auto& x = joined.first;
+  Assert::is_true(x.indexView() == std::vector<int>({3, 5, 5, 9, 20})
+                  && x.valuesView() == std::vector<int>({2, 3, 4, 5, 6})
+                  && joined.second.indexView() == x.indexView()
+                  && joined.second.valuesView()
+                     == std::vector<double>({30, 30, 30, 90, 100}),
+                  "wrong as-of join", __func__);
+}
+
+
+void test_inner_join()
+{
+  std::vector<int> xi, yi;
+  for (int i=0; i < 1000; ++i) xi.push_back(i);
+  for (int i=0; i < 1000; i += 37) yi.push_back(i);
+  yi.push_back(5000);
+  Series<int, int> x(xi, xi);
+  Series<int, int> y(yi, std::vector<int>(yi.size(), 1));
+  auto joined = inner_join(y, x);
+  yi.pop_back();
+  Assert::is_true(joined.first.indexView() == yi
+                  && joined.second.valuesView() == yi
+                  && joined.first.valuesView()
+                     == std::vector<int>(yi.size(), 1),
+                  "wrong inner join", __func__);
+}
+
+
+void test_resample()
+{
+  Series<int, double> x({-3, -1, 0, 4, 5, 12, 13, 14},
+                        {1, 2, 3, 4, na::na<double>(), 6, 7, 8});
+  auto sums = resample(x, 5);
+  auto& v = sums.valuesView();
+  Assert::is_true(sums.indexView() == std::vector<int>({-5, 0, 5, 10})
+                  && v[0] == 3 && v[1] == 7 && na::is_na(v[2]) && v[3] == 21,
+                  "wrong sums", __func__);
+  auto counts = resample<Count>(x, 5);
+  Assert::is_true(counts.valuesView() == std::vector<size_t>({2, 2, 0, 3}),
+                  "wrong counts", __func__);
+  auto bars = resample<Ohlc>(x, 10);
+  auto& b = bars.valuesView();
+  Assert::is_true(bars.indexView() == std::vector<int>({-10, 0, 10})
+                  && b[1].open == 3 && b[1].high == 4 && b[1].low == 3
+                  && b[1].close == 4 && b[2].open == 6 && b[2].low == 6
+                  && b[2].high == 8 && b[2].close == 8,
+                  "wrong ohlc", __func__);
+  Series<double, std::pair<double, double> > trades(
+      {0.5, 0.7, 1.2}, {{10, 1}, {20, 3}, {5, 2}});
+  auto vwap = resample<Vwap<> >(trades, 1.0);
+  Assert::is_true(vwap.indexView() == std::vector<double>({0, 1})
+                  && vwap.valuesView() == std::vector<double>({17.5, 5}),
+                  "wrong vwap", __func__);
+}
+
+
+void test_resample_fused()
+{
+  Series<int, std::pair<double, double> > trades(
+      {1, 2, 3, 11, 12}, {{10, 1}, {20, 3}, {5, 2}, {7, 1}, {9, 1}});
+  auto bars = resample_fused<Field<0, Ohlc<> >, Field<1, Sum<> >,
+                             Field<1, Count<> >, Vwap<> >(trades, 10);
+  auto& ohlc = bars.column<0>();
+  Assert::is_true(bars.index() == std::vector<int>({0, 10})
+                  && ohlc[0].open == 10 && ohlc[0].high == 20
+                  && ohlc[0].low == 5 && ohlc[0].close == 5
+                  && ohlc[1].open == 7 && ohlc[1].close == 9
+                  && bars.column<1>() == std::vector<double>({6, 2})
+                  && bars.column<2>() == std::vector<size_t>({3, 2})
+                  && bars.column<3>() == std::vector<double>({80. / 6, 8}),
+                  "wrong bars", __func__);
+  auto volume = resample<Field<1, Sum<> > >(trades, 10);
+  Assert::is_true(bars.series<1>() == volume, "wrong volume series",
+                  __func__);
+}
+
+
+void test_integer_aggregators()
+{
+  const int64_t big = int64_t(1) << 60;
+  Series<int64_t, int64_t> volumes({0, 1, 2, 10}, {big, 1, 3, 7});
+  auto sums = resample(volumes, 10);
+  Assert::is_true(sums.valuesView() == std::vector<int64_t>({big + 4, 7}),
+                  "wrong integer sums", __func__);
+  auto maxs = resample<Max>(volumes, 10);
+  Assert::is_true(maxs.valuesView() == std::vector<int64_t>({big, 7}),
+                  "wrong integer maxima", __func__);
+  Series<int, int> small({0, 1}, {2000000000, 2000000000});
+  auto small_sums = resample(small, 10);
+  Assert::is_true(small_sums.valuesView() == std::vector<int64_t>({4000000000}),
+                  "small integers not summed in 64 bits", __func__);
+  bool thrown = false;
+  try {
+    Series<int, int64_t> huge({0, 1}, {big * 4, big * 4});
+    resample(huge, 10);
+  } catch (TsException&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "integer overflow not detected", __func__);
+}
+
+
+void test_cov_matrix()
+{
+  const size_t N = 4;
+  std::vector<Series<int, double> > series(N);
+  std::vector<std::vector<double> > complete(N); // the complete rows
+  std::srand(6);
+  for (int t=0; t < 500; ++t) {
+    std::vector<double> row(N);
+    bool all = true;
+    for (size_t k=0; k < N; ++k) {
+      row[k] = (k + 1) * (std::rand() % 100) + (k > 0 ? row[k - 1] : 0);
+      if (t % 13 == 0 && k == 2) row[k] = na::na<double>();
+      if (std::rand() % 10 == 0) {
+        all = false;
+      } else {
+        series[k].append(t, row[k]);
+      }
+    }
+    if (!all || na::is_na(row[2])) continue;
+    for (size_t k=0; k < N; ++k) complete[k].push_back(row[k]);
+  }
+  std::vector<const Series<int, double>*> ptrs;
+  for (auto& s: series) ptrs.push_back(&s);
+  auto m = cov_matrix(ptrs, 2, 7);
+  bool ok = m.n_obs() == complete[0].size();
+  for (size_t i=0; i < N; ++i) {
+    for (size_t j=0; j < N; ++j) {
+      filters::OnlineCovUnknownMeans est;
+      for (size_t r=0; r < complete[i].size(); ++r) {
+        est(complete[i][r], complete[j][r]);
+      }
+      ok = ok && std::fabs(m.cov(i, j) - est.cov()) < 1e-6 * est.var1()
+        && std::fabs(m.corr(i, j) - est.corr()) < 1e-9;
+    }
+  }
+  Assert::is_true(ok, "wrong covariance matrix", __func__);
+
+  CovMatrix one(2);
+  const double first_row[] = {1.0, 2.0};
+  one.add_block(first_row, 1);
+  Assert::is_true(na::is_na(one.cov(0, 1)) && na::is_na(one.corr(0, 1))
+                  && na::is_na(CovMatrix(2).corr(0, 0)),
+                  "covariance matrix of a single row not NA", __func__);
+}
+
+
+void test_rolling_beta()
+{
+  const int window = 30;
+  std::srand(7);
+  Series<int, double> x;
+  for (int t=0; t < 300; ++t) x.append(t, std::rand() % 100 / 10.0);
+  std::vector<Series<int, double> > ys(3);
+  for (size_t k=0; k < ys.size(); ++k) {
+    for (int t=0; t < 300; t += 1 + std::rand() % (k + 2)) {
+      ys[k].append(t, (k + 1) * x.valuesView()[t] + std::rand() % 10);
+    }
+  }
+  std::vector<const Series<int, double>*> ptrs;
+  for (auto& y: ys) ptrs.push_back(&y);
+  auto res = rolling_beta(x, ptrs, window);
+
+  bool ok = true;
+  for (size_t k=0; k < ys.size(); ++k) {
+    // the pairs of x summed since the previous timestamp of y and y
+    std::vector<int> ts;
+    std::vector<double> px, py;
+    int prev = -1;
+    for (size_t j=0; j < ys[k].size(); ++j) {
+      int t = ys[k].indexView()[j];
+      double sum = 0;
+      for (int u=prev + 1; u <= t; ++u) sum += x.valuesView()[u];
+      ts.push_back(t);
+      px.push_back(sum);
+      py.push_back(ys[k].valuesView()[j]);
+      prev = t;
+    }
+    Series<int, double> beta, corr;
+    for (size_t j=0; j < ts.size(); ++j) {
+      if (ts[j] < ts[0] + window) continue;
+      double mx = 0, my = 0, n = 0, cxx = 0, cyy = 0, cxy = 0;
+      for (size_t i=0; i <= j; ++i) {
+        if (ts[i] <= ts[j] - window) continue;
+        mx += px[i];
+        my += py[i];
+        ++n;
+      }
+      mx /= n;
+      my /= n;
+      for (size_t i=0; i <= j; ++i) {
+        if (ts[i] <= ts[j] - window) continue;
+        cxx += (px[i] - mx) * (px[i] - mx);
+        cyy += (py[i] - my) * (py[i] - my);
+        cxy += (px[i] - mx) * (py[i] - my);
+      }
+      beta.append(ts[j], cxy / cxx);
+      corr.append(ts[j], cxy / std::sqrt(cxx * cyy));
+    }
+    ok = ok && res.beta[k].indexView() == beta.indexView()
+            && res.corr[k].indexView() == corr.indexView();
+    for (size_t j=0; ok && j < beta.size(); ++j) {
+      ok = std::fabs(res.beta[k].valuesView()[j] - beta.valuesView()[j]) < 1e-9
+        && std::fabs(res.corr[k].valuesView()[j] - corr.valuesView()[j]) < 1e-9;
+    }
+  }
+  Assert::is_true(ok, "rolling betas differ from brute force", __func__);
+}
+
+
+void test_slice()
+{
+  std::vector<int> index;
+  std::vector<double> values;
+  for (int i=0; i < 100; ++i) {
+    index.push_back(2 * i);
+    values.push_back(i % 10);
+  }
+  Series<int, double> x(index, values);
+  auto v = x.slice(11, 40);
+  auto copy = Series<int, double>(
+      std::vector<int>(index.begin() + 6, index.begin() + 20),
+      std::vector<double>(values.begin() + 6, values.begin() + 20)
+  );
+  Assert::is_true(v.size() == 14 && v.indexView().front() == 12
+                  && v.indexView().back() == 38
+                  && v.values_data() == x.values_data() + 6
+                  && v.to_series() == copy,
+                  "wrong slice", __func__);
+  Assert::almost_equal(v.mean(), copy.mean(), "wrong mean of a slice",
+                       __func__, 1e-12);
+  Assert::is_true(x.slice(300, 400).size() == 0 && x.slice(5, 5).size() == 0
+                  && x.view().size() == x.size(),
+                  "wrong empty slices", __func__);
+
+  // the views work with the merging and the covariance
+  auto w = x.slice(0, 30);
+  SeriesCollection<SeriesView<int, double> > coll({&v, &w});
+  size_t n_rows = 0;
+  for (auto row = coll.aligned_merge_iterator(); row; ++row) ++n_rows;
+  Assert::is_true(n_rows == 20, "wrong merge of views", __func__);
+  Assert::almost_equal(cov(v, x.slice(12, 50)),
+                       cov(copy, x.slice(12, 50).to_series()),
+                       "wrong covariance of views", __func__, 1e-12);
+}
+
+
+void test_mapped_series()
+{
+  std::vector<int64_t> index;
+  std::vector<double> values;
+  for (int i=0; i < 1000; ++i) {
+    index.push_back(3 * i);
+    values.push_back(i % 17 == 0 ? na::na<double>() : i / 7.0);
+  }
+  Series<int64_t, double> x(index, values);
+  const std::string path = "series_tests_mapped.bin";
+  write_mapped(path, x, true);
+  {
+    MappedSeries<int64_t, double> m(path);
+    bool same = m.size() == x.size() && m.has_na_bitmap();
+    for (size_t i=0; same && i < x.size(); ++i) {
+      same = m.indexView()[i] == index[i]
+        && (m.is_na(i) ? na::is_na(values[i]) : m.valuesView()[i] == values[i]);
+    }
+    Assert::is_true(same, "wrong mapped values", __func__);
+    Assert::almost_equal(m.mean(), x.mean(), "wrong mean", __func__, 1e-12);
+    Assert::is_true(m.slice(54, 99).to_series() == x.slice(54, 99).to_series(),
+                    "wrong slice", __func__);
+    MappedSeries<int64_t, double> moved(std::move(m));
+    Assert::is_true(m.size() == 0 && !m.has_na_bitmap()
+                    && m.indexView().empty() && moved.size() == x.size(),
+                    "wrong moved-from series", __func__);
+    MappedSeries<int64_t, double> other(path);
+    other = std::move(moved);
+    Assert::is_true(moved.size() == 0 && other.size() == x.size()
+                    && other.has_na_bitmap(),
+                    "wrong move assignment", __func__);
+  }
+  bool thrown = false;
+  try {
+    MappedSeries<int, double> wrong(path);
+  } catch (IoError&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "wrong types not detected", __func__);
+  std::remove(path.c_str());
+}
+
+
+void test_parse_double()
+{
+  std::srand(8);
+  bool ok = true;
+  std::vector<std::string> texts = {
+    "0", "-0.5", "+3.25", "1e5", "1.5E-3", "123456789012345678901234",
+    "0.1", "2.2250738585072014e-308", "1.7976931348623157e308",
+    "0.000000000000000000000000001", "inf", "nan"
+  };
+  for (int i=0; i < 1000; ++i) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%d.%0*d", std::rand() % 100000,
+                  1 + i % 9, std::rand() % 1000000);
+    texts.push_back(buf);
+  }
+  for (auto& t: texts) {
+    double x;
+    ok = ok && impl::parse_number(t.data(), t.data() + t.size(), x);
+    double y = std::strtod(t.c_str(), nullptr);
+    ok = ok && (x == y || (std::isnan(x) && std::isnan(y)));
+  }
+  double x;
+  for (std::string bad: {"1.5x", " 1.5", "1.5 ", " 1e400", "1e400 "}) {
+    ok = ok && !impl::parse_number(bad.data(), bad.data() + bad.size(), x);
+  }
+  Assert::is_true(ok, "wrong parsed numbers", __func__);
+}
+
+
+void test_read_csv()
+{
+  const std::string path = "series_tests_read.csv";
+  std::vector<int64_t> index;
+  std::vector<double> values;
+  {
+    std::ofstream out(path);
+    out << "time;symbol;price\r\n";
+    for (int i=0; i < 3000; ++i) {
+      index.push_back(1000 + i / 2);
+      values.push_back(i % 101 == 0 ? na::na<double>() : i / 8.0);
+      out << index.back() << ";X;";
+      if (i % 101 != 0) out << values.back();
+      out << (i % 2 ? "\r\n" : "\n");
+      if (i % 500 == 0) out << "\n";
+    }
+  }
+  CsvOptions opts;
+  opts.separator = ';';
+  opts.header = true;
+  opts.value_column = 2;
+  opts.n_threads = 3;
+  opts.block_size = 5000;
+  auto x = read_csv<int64_t, double>(path, opts);
+  bool ok = x.indexView() == index && x.size() == values.size();
+  for (size_t i=0; ok && i < values.size(); ++i) {
+    ok = x.valuesView()[i] == values[i]
+      || (na::is_na(values[i]) && na::is_na(x.valuesView()[i]));
+  }
+  Assert::is_true(ok, "wrong series read", __func__);
+
+  {
+    std::ofstream out(path);
+    out << "1,1\n2,2\n3,3\n2,4\n";
+  }
+  bool thrown = false;
+  try {
+    read_csv<int, int>(path);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "unsorted file not detected", __func__);
+
+  for (std::string text: {"1,1\n,2\n3,3\n", "1,1\nNA,2\n3,3\n",
+                          "1,1\nnan,2\n3,3\n"}) {
+    {
+      std::ofstream out(path);
+      out << text;
+    }
+    thrown = false;
+    try {
+      read_csv<double, double>(path);
+    } catch (IoError&) {
+      thrown = true;
+    }
+    ok = ok && thrown;
+  }
+  Assert::is_true(ok, "NA timestamp not detected", __func__);
+  std::remove(path.c_str());
+}
+
+
+void test_read_binary()
+{
+  const std::string path = "series_tests_read.bin";
+  std::vector<int32_t> index;
+  std::vector<double> values;
+  for (int i=0; i < 5000; ++i) {
+    index.push_back(i / 3);
+    values.push_back(i * 0.25);
+  }
+  Series<int32_t, double> x(index, values);
+  write_binary(path, x);
+  Assert::is_true(read_binary<int32_t, double>(path, 3, 1000) == x,
+                  "wrong series read", __func__);
+  std::swap(index[2500], index[2600]);
+  write_binary(path, Series<int32_t, double>::from_sorted(index, values));
+  bool thrown = false;
+  try {
+    read_binary<int32_t, double>(path, 3, 1000);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "unsorted file not detected", __func__);
+  std::remove(path.c_str());
+}
+
+
+void test_append_bulk()
+{
+  Series<int, double> x;
+  x.reserve(100);
+  Assert::is_true(x.capacity() >= 100, "wrong capacity", __func__);
+  int ix[] = {1, 2, 5, 7};
+  double vals[] = {10, 20, 50, 70};
+  x.append_bulk(ix, vals, 4);
+  x.append_unchecked(8, 80);
+  x.append(9, 90);
+  bool thrown = false;
+  int bad[] = {10, 12, 12};
+  try {
+    x.append_bulk(bad, vals, 3);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown && x.size() == 6, "repeated timestamp accepted",
+                  __func__);
+  thrown = false;
+  try {
+    x.append_bulk(ix + 3, vals, 1);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "block preceding the series accepted", __func__);
+  Assert::is_true(
+      x == Series<int, double>({1, 2, 5, 7, 8, 9}, {10, 20, 50, 70, 80, 90}),
+      "wrong series after appends", __func__
+  );
+}
+
+
+void test_chunked_series()
+{
+  typedef Series<int, double, ChunkedStorage<4> > Chunked;
+  std::vector<int> ix;
+  std::vector<double> vals;
+  for (int i=0; i < 11; ++i) {
+    ix.push_back(3 * i);
+    vals.push_back(std::sin(i));
+  }
+  Series<int, double> expected(ix, vals);
+  Chunked x;
+  x.reserve(11);
+  for (size_t i=0; i < 5; ++i) x.append(ix[i], vals[i]);
+  x.append_bulk(ix.data() + 5, vals.data() + 5, 5);
+  x.append_unchecked(ix[10], vals[10]);
+  Assert::is_true(x.size() == 11 && x.n_chunks() == 3, "wrong size",
+                  __func__);
+  Assert::is_true(x.chunk(2).size() == 3, "wrong last chunk", __func__);
+  bool thrown = false;
+  try {
+    x.append(30, 1.0);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "repeated timestamp accepted", __func__);
+  Assert::is_true(x.to_series() == expected, "wrong observations", __func__);
+  Assert::is_true(Chunked(ix, vals) == x, "wrong vector ctor", __func__);
+  auto copy = x;
+  copy.append(31, 1.0);
+  Assert::is_true(copy.size() == 12 && x.size() == 11, "shallow copy",
+                  __func__);
+  // the moved-from series are empty and usable
+  auto moved = std::move(copy);
+  Assert::is_true(moved.size() == 12 && copy.size() == 0
+                  && copy.begin_paired() == copy.end_paired(),
+                  "wrong moved-from series", __func__);
+  copy.append(1, 2.0);
+  moved = std::move(copy);
+  copy.append_unchecked(5, 6.0);
+  Assert::is_true(moved.to_series() == Series<int, double>({1}, {2.0})
+                  && copy.to_series() == Series<int, double>({5}, {6.0}),
+                  "wrong move assignment", __func__);
+  Assert::is_true(x.at(12) == expected.at(12) && x[13] == expected[13]
+                  && x[30] == expected[30], "wrong at()", __func__);
+  thrown = false;
+  try {
+    x.at(31);
+  } catch (IndexError<int>&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "at() past the end", __func__);
+  Assert::is_true(std::abs(x.mean() - expected.mean()) < 1e-12
+                  && std::abs(x.var() - expected.var()) < 1e-12,
+                  "wrong moments", __func__);
+  std::vector<int> ts_many{-1, 3, 4, 11, 12, 27, 30};
+  Assert::is_true(x.at_many(ts_many) == expected.at_many(ts_many),
+                  "wrong at_many() across the chunks", __func__);
+  auto est = x.parallel_apply(filters::OnlineMean(), 2);
+  Assert::is_true(std::abs(est.value() - expected.mean()) < 1e-12,
+                  "wrong parallel_apply", __func__);
+  // the ranges of the threads split the chunks
+  Series<int, double, ChunkedStorage<1000> > big;
+  for (int i=0; i < 200000; ++i) big.append(i, std::sin(i));
+  auto big_est = big.parallel_apply(filters::OnlineVarUnknownMean(), 3);
+  Assert::is_true(big_est.n_processed() == 200000
+                  && std::abs(big_est.value() - big.var()) < 1e-12,
+                  "wrong parallel_apply across the chunks", __func__);
+  // the merge goes through the chunk boundaries
+  Chunked y({1, 4, 7, 40}, {1, 2, 3, 4});
+  std::vector<const Chunked*> ptrs{&x, &y};
+  auto merged = MergeIterator<Chunked>::from_series_ptrs(ptrs);
+  std::vector<int> ts;
+  for (; merged; ++merged) ts.push_back(merged.timestamp());
+  Assert::is_true(ts.size() == 15 && std::is_sorted(ts.begin(), ts.end()),
+                  "wrong merge", __func__);
+  auto acc = Accumulator<filters::RollingMean, int>(filters::RollingMean(3));
+  x.apply_pairs(acc);
+  auto acc2 = Accumulator<filters::RollingMean, int>(filters::RollingMean(3));
+  expected.apply_pairs(acc2);
+  Assert::is_true(acc.value() == acc2.value(), "wrong accumulation",
+                  __func__);
+}
+
+
+void test_ring_series()
+{
+  RingSeries<int> x(4);
+  Assert::is_true(x.empty() && x.capacity() == 4, "wrong empty ring",
+                  __func__);
+  for (int i=1; i <= 3; ++i) x.append(i, 10 * i);
+  Assert::is_true(x.to_series() == Series<int>({1, 2, 3}, {10, 20, 30}),
+                  "wrong partial ring", __func__);
+  for (int i=4; i <= 6; ++i) x.append(i, 10 * i);
+  Assert::is_true(x.full() && x.size() == 4, "wrong size", __func__);
+  Assert::is_true(x.older_part().size() == 2 && x.newer_part().size() == 2,
+                  "wrong parts", __func__);
+  auto expected = Series<int>({3, 4, 5, 6}, {30, 40, 50, 60});
+  Assert::is_true(x.to_series() == expected, "wrong eviction", __func__);
+  Assert::is_true(x.at(3) == 30 && x[4] == 40 && x.at(5) == 50
+                  && x[6] == 60, "wrong at()", __func__);
+  bool thrown = false;
+  try {
+    x.at(7);
+  } catch (IndexError<int>&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "at() past the end", __func__);
+  thrown = false;
+  try {
+    x.append(6, 0);
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "repeated timestamp accepted", __func__);
+  Assert::is_true(x.mean() == expected.mean() && x.var() == expected.var(),
+                  "wrong moments", __func__);
+  Assert::is_true(x.at_many({2, 4, 6}) == std::vector<double>({30, 40, 60}),
+                  "wrong at_many() across the parts", __func__);
+  // merging and accumulating go from the oldest observation
+  auto merged = MergeIterator<RingSeries<int> >::from_series_ptrs(
+      std::vector<const RingSeries<int>*>{&x});
+  std::vector<int> ts;
+  for (; merged; ++merged) ts.push_back(merged.timestamp());
+  Assert::is_true(ts == std::vector<int>({3, 4, 5, 6}), "wrong merge",
+                  __func__);
+  auto acc = Accumulator<filters::RollingMean, int>(filters::RollingMean(2));
+  x.apply_pairs(acc);
+  Assert::is_true(acc.value() == Series<int>({4, 5, 6}, {35, 45, 55}),
+                  "wrong accumulation", __func__);
+  x.trim_before(5);
+  Assert::is_true(x.to_series() == Series<int>({5, 6}, {50, 60}),
+                  "wrong trim", __func__);
+  x.append(8, 80);
+  x.trim_before(100);
+  Assert::is_true(x.empty() && x.to_series().size() == 0, "wrong clear",
+                  __func__);
+}
+
+
+void test_timestamp_lookup()
+{
+  std::srand(7);
+  // uniform, jittered with repeats and very skewed timestamps
+  std::vector<std::vector<long> > indices(3);
+  for (long i=0; i < 1000; ++i) {
+    indices[0].push_back(10 * i);
+    indices[1].push_back(10 * i + std::rand() % 25);
+    indices[2].push_back(i * i * i);
+  }
+  std::sort(indices[1].begin(), indices[1].end());
+  bool ok = true;
+  for (auto& ix: indices) {
+    auto first = ix.data(), last = first + ix.size();
+    for (int k=0; k < 2000; ++k) {
+      long t = std::rand() % (ix.back() + 20) - 10;
+      ok = ok && impl::timestamp_lower_bound(first, last, t)
+                 == std::lower_bound(first, last, t);
+    }
+    ok = ok && impl::timestamp_lower_bound(first, first, 5L) == first;
+  }
+  Assert::is_true(ok, "wrong lower bound", __func__);
+  // nanosecond timestamps closer to each other than the ulp of a double
+  const int64_t b = 1700000000000000000LL;
+  std::vector<int64_t> nix;
+  for (int64_t i=0; i < 100; ++i) nix.push_back(b + 50 * i + i % 3);
+  for (int64_t t = b - 10; t < b + 5010; t += 7) {
+    ok = ok && impl::timestamp_lower_bound(&nix[0], &nix[0] + 100, t)
+               == std::lower_bound(&nix[0], &nix[0] + 100, t);
+  }
+  Assert::is_true(ok, "wrong lower bound of close timestamps", __func__);
+  Assert::is_true(
+      Series<int64_t>({b, b + 50, b + 100}, {1, 2, 3}).at(b + 50) == 2,
+      "wrong at() of close timestamps", __func__
+  );
+  std::vector<double> inf{-INFINITY, 0.0, 1.0, INFINITY};
+  Assert::is_true(impl::timestamp_lower_bound(&inf[0], &inf[0] + 4, 0.5)
+                  == &inf[2], "wrong lower bound with infinities", __func__);
+  std::vector<double> dix{0.5, 1.0, 1.0, 2.5, 8.0};
+  Assert::is_true(impl::timestamp_lower_bound(&dix[0], &dix[0] + 5, 1.0)
+                  == &dix[1], "wrong lower bound of doubles", __func__);
+
+  std::vector<double> vals(indices[1].size());
+  for (size_t i=0; i < vals.size(); ++i) vals[i] = double(i);
+  Series<long> x(indices[1], vals);
+  std::vector<long> ts{-3, 0, 17, 17, 4000, 9990};
+  auto res = x.at_many(ts);
+  ok = res.size() == ts.size();
+  for (size_t i=0; ok && i < ts.size(); ++i) ok = res[i] == x.at(ts[i]);
+  Assert::is_true(ok, "wrong at_many", __func__);
+  bool thrown = false;
+  try {
+    x.at_many({5, 3});
+  } catch (IndexNotSorted&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "unsorted timestamps accepted", __func__);
+  thrown = false;
+  try {
+    x.at_many({5, x.indexView().back() + 1});
+  } catch (IndexError<long>&) {
+    thrown = true;
+  }
+  Assert::is_true(thrown, "at_many() past the end", __func__);
+}
+
+
 int main()
 {
   test_parameterless_ctor();
@@ -196,12 +1022,35 @@ int main()
   test_vector_ctor_nonincreasing();
   test_append_simple();
   test_append_nonincreasing();
+  test_append_bulk();
+  test_chunked_series();
+  test_ring_series();
+  test_timestamp_lookup();
   test_at_ok();
   test_at_fail();
   test_mean(10);
   test_mean(49);
   test_var_known_mean(13);
   test_var_estimated_mean();
+  test_mean_var_blocks();
+  test_block_moments();
+  test_merge_estimators();
+  test_parallel_apply();
+  test_apply_each_parallel();
+  test_merge_iterator();
+  test_aligned_merge_iterator();
+  test_asof_join();
+  test_inner_join();
+  test_resample();
+  test_resample_fused();
+  test_integer_aggregators();
+  test_cov_matrix();
+  test_rolling_beta();
+  test_slice();
+  test_mapped_series();
+  test_parse_double();
+  test_read_csv();
+  test_read_binary();
   test_cov_known_means();
   test_cov_estimated_means();
 }